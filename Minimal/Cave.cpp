@@ -4,26 +4,50 @@
 #include "TexturedCube.h"
 #include "Definitions.h"
 #include "Shaders.h"
-#include "Lines.h"
+#include "DebugDraw.h"
+#include "GLState.h"
+#include "RenderQueue.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <vector>
 
 //Rendering specs
-#define TEX_WIDTH 1024
-#define TEX_HEIGHT 1024
 #define NEAR_PLANE 0.01f
 #define FAR_PLANE 10000.0f
 
-//Planes
-#define CAVE_SIZE 2.4f
-Quad * planeL;
-Quad * planeR;
-Quad * planeB;
-
-//Plane variables
-glm::mat4 rotation = glm::mat4(1);
-glm::vec3 corners[10];	//0-2 planeL, 3-5 planeR, 6-8 planeB
-
-//Debug Lines
-Lines * lines;
+//Adaptive wall resolution: pool of render sizes, rendered into the corner of the layer. The layers
+//of an eye are all as large as its largest wall (layered rendering needs one size), so memory
+//follows the walls: 2 eyes x 3 walls x 8 bytes per texel is 48 MB at 1024, 192 MB at 2048.
+const int WALL_SIZES[] = { 256, 512, 1024, 2048 };
+#define WALL_SIZE_COUNT 4
+#define WALL_SIZE_HYSTERESIS 0.75f		//shrink only once the footprint fits this fraction of the smaller size
+#define WALL_SIZE_DOWNGRADE_FRAMES 45	//...for this many consecutive frames
+
+//Render mode benchmark: frames per mode, the first few are dropped while timings catch up
+#define BENCHMARK_FRAMES 300
+#define BENCHMARK_WARMUP 30
+
+//Wall cache tolerances (meters), below which a wall image is reused
+#define CACHE_EYE_TOLERANCE 0.0005f
+#define CACHE_CUBE_TOLERANCE 0.00001f
+
+//Wall reprojection: largest estimated warp error (texels) and frames before a forced re-render
+#define REPROJECT_MAX_ERROR 1.5f
+#define REPROJECT_REFRESH_FRAMES 45
+#define REPROJECT_MIN_DEPTH 0.05f	//reference plane must be at least this far in front of the eye
+#define CUBE_RADIUS 0.87f			//bounding sphere of the unit cube
+
+//Wall scheduling: GPU time for wall passes per frame, and frames a peripheral wall may stay stale
+#define WALL_GPU_BUDGET 4.0f
+#define WALL_MAX_DEFER_FRAMES 3
+#define WALL_NEVER_RENDERED (1 << 20)	//age of a wall that has no image yet
+
+//Walls (loaded from the CAVE config)
+CaveGeometry * geometry;
+std::vector<Quad *> planes;
 
 //Skybox
 Skybox * skyboxL;
@@ -35,6 +59,7 @@ TexturedCube * cube;
 //Cube variables
 #define CUBE_SCALE glm::vec3(0.3f)
 #define CUBE_POSITION glm::vec3(0, -0.1f, -1.0f)
+#define CUBE_FIELD_FILL 0.5f	//fraction of a grid cell each cube of a field fills
 glm::vec3 cubePosition;
 glm::vec3 cubeScaleFactor;
 
@@ -44,276 +69,715 @@ glm::vec3 cubeScaleFactor;
 
 Cave::~Cave() {
 	//Delete planes
-	delete(planeL);
-	delete(planeR);
-	delete(planeB);
-	//Delete lines
-	delete(lines);
+	for (int wall = 0; wall < wallCount; wall++) delete(planes[wall]);
+	planes.clear();
+	delete(geometry);
 	//Delete skyboxes
 	delete(skyboxL);
 	delete(skyboxR);
 	//Delete cube
 	delete(cube);
 	//Deallocate OpenGL buffers, textures, etc
-	glDeleteFramebuffers(1, &FBO);
-	glDeleteTextures(1, &renderedTexture);
-	glDeleteRenderbuffers(1, &rboId);
+	glDeleteFramebuffers(wallCount, wallFBO[0]);
+	glDeleteFramebuffers(wallCount, wallFBO[1]);
+	glDeleteFramebuffers(2, layeredFBO);
+	glDeleteTextures(2, wallTexture);
+	glDeleteTextures(2, wallDepth);
+	glDeleteBuffers(2, eyeBlock);
 }
 
-Cave::Cave(){
+Cave::Cave() : Cave(CAVE_CONFIG) { }
+
+Cave::Cave(const char * configPath) : scheduler(WALL_GPU_BUDGET, WALL_MAX_DEFER_FRAMES) {
+	geometry = new CaveGeometry(configPath);
+	wallCount = geometry->getWallCount();
+
+	for (int eye = 0; eye < 2; eye++) {
+		for (int wall = 0; wall < MAX_WALLS; wall++) {
+			wallSize[eye][wall] = WALL_SIZES[WALL_SIZE_COUNT - 2];
+			wallDowngrade[eye][wall] = 0;
+			wallAge[eye][wall] = WALL_NEVER_RENDERED;
+		}
+		layerSize[eye] = WALL_SIZES[WALL_SIZE_COUNT - 2];
+	}
+
 	initPlanes();
-	initCorners();
-	initLines();
 	initSkybox();
 	initObjects();
 	initFrameBuffer();
+	initSamplers();
+	setCubeCount(1);
+
+	//Composite eye position and warps of each eye, shared by both wall shaders (bound to CaveEye when linked)
+	glGenBuffers(2, eyeBlock);
 }
 
 void Cave::initPlanes() {
-	planeL = new Quad(CAVE_SIZE);
-	planeR = new Quad(CAVE_SIZE);
-	planeB = new Quad(CAVE_SIZE);
+	//One quad per wall, built directly from its world space corners
+	for (int wall = 0; wall < wallCount; wall++)
+		planes.push_back(new Quad(geometry->getCorner(wall, 0), geometry->getCorner(wall, 1), geometry->getCorner(wall, 3)));
+}
 
-	//Rotate
-	float rad = MATH_PI / 180.0f;
-	planeL->toWorld = planeL->toWorld * glm::rotate(glm::mat4(1.0f), 90.0f * rad, glm::vec3(0, 1, 0));
-	planeB->toWorld = planeB->toWorld * glm::rotate(glm::mat4(1.0f), -90.0f * rad, glm::vec3(1, 0, 0));
+void Cave::initSkybox() {
+	skyboxL = new Skybox(TEXTURE_SKYBOX_LEFT);
+	skyboxR = new Skybox(TEXTURE_SKYBOX_RIGHT);
+}
 
-	//Translate
-	float half = CAVE_SIZE / 2.0f;
-	planeL->toWorld[3] = glm::vec4(-half, 0, 0, 1);
-	planeR->toWorld[3] = glm::vec4(0, 0, -half, 1);
-	planeB->toWorld[3] = glm::vec4(0, -half, 0, 1);
+void Cave::initObjects() {
+	cube = new TexturedCube(TEXTURE_CUBE_STEAM);
+	cubePosition = CUBE_POSITION;
+	cubeScaleFactor = CUBE_SCALE;
+}
 
-	//Rotate "this" obj
-	rotation = rotation * glm::rotate(glm::mat4(1.0f), -45.0f * rad, glm::vec3(0, 1, 0));
+void Cave::initSamplers() {
+	//Wall array on unit 0, skybox cube map on unit 1, fixed for both composite programs. A sampler
+	//left on its default unit would share unit 0 with the array, which fails every draw.
+	const ShaderProgram * composites[2] = { &Shaders::getRenderedTextureShader(), &Shaders::getLCDisplayShader() };
+	for (const ShaderProgram * shader : composites) {
+		shader->use();
+		glUniform1i(shader->get(UNIFORM_TEXTURE), 0);
+		glUniform1i(shader->get(UNIFORM_SKYBOX), 1);
+	}
+}
 
+void Cave::initFrameBuffer() {
+	glGenFramebuffers(2, layeredFBO);
+
+	for (int eye = 0; eye < 2; eye++) {
+		glGenFramebuffers(wallCount, wallFBO[eye]);
+		initRenderedTexture(eye);
+		initDepthBuffer(eye);
+
+		//Per-wall FBOs (one layer each)
+		for (int wall = 0; wall < wallCount; wall++) {
+			glBindFramebuffer(GL_FRAMEBUFFER, wallFBO[eye][wall]);
+			glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, wallTexture[eye], 0, wall);
+			glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, wallDepth[eye], 0, wall);
+
+			if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+				std::cerr << "=== SOMETHING WENT WRONG ===" << std::endl;
+		}
+
+		//Layered FBO (every layer, the geometry shader picks gl_Layer)
+		glBindFramebuffer(GL_FRAMEBUFFER, layeredFBO[eye]);
+		glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, wallTexture[eye], 0);
+		glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, wallDepth[eye], 0);
+
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+			std::cerr << "=== SOMETHING WENT WRONG (layered) ===" << std::endl;
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
-void Cave::initCorners() {
-	float half = CAVE_SIZE / 2.0f;
+void Cave::initRenderedTexture(int eye) {
+	glGenTextures(1, &wallTexture[eye]);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, wallTexture[eye]);
 
-	corners[0] = glm::vec3(-half, half, half); corners[1] = glm::vec3(-half, -half, half); corners[2] = glm::vec3(-half, -half, -half);
-	corners[3] = glm::vec3(-half, half, -half); corners[4] = glm::vec3(-half, -half, -half); corners[5] = glm::vec3(half, -half, -half);
-	corners[6] = glm::vec3(-half, -half, -half); corners[7] = glm::vec3(-half, -half, half); corners[8] = glm::vec3(half, -half, half);
-	corners[9] = glm::vec3(half, half, -half);
+	allocateLayers(eye, GL_RGBA8);
 
-	for (int i = 0; i < 10; i++) {
-		glm::mat4 a = glm::mat4(1.0f);
-		a[3] = glm::vec4(corners[i].x, corners[i].y, corners[i].z, 1.0f);
-		a = rotation * a;
-		corners[i] = a[3];
-	}
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
 }
 
-void Cave::initLines() {
-	lines = new Lines();
-	
-	//add eyepos placeholder
-	lines->addVertex(glm::vec3(0));
+void Cave::initDepthBuffer(int eye) {
+	//Layered framebuffers need a layered depth attachment, so this is a texture array rather than a renderbuffer
+	glGenTextures(1, &wallDepth[eye]);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, wallDepth[eye]);
+
+	allocateLayers(eye, GL_DEPTH_COMPONENT24);
 
-	//add corners
-	for (int i = 0; i < 10; i++) lines->addVertex(corners[i]);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
 }
 
-void Cave::initSkybox() {
-	skyboxL = new Skybox(TEXTURE_SKYBOX_LEFT);
-	skyboxR = new Skybox(TEXTURE_SKYBOX_RIGHT);
+void Cave::allocateLayers(int eye, GLenum format) {
+	//Storage of the bound array, every wall at the eye's layer size
+	if (format == GL_DEPTH_COMPONENT24) glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, format, layerSize[eye], layerSize[eye], wallCount, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	else glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, format, layerSize[eye], layerSize[eye], wallCount, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
 }
 
-void Cave::initObjects() {
-	cube = new TexturedCube(TEXTURE_CUBE_STEAM);
-	cubePosition = CUBE_POSITION;
-	cubeScaleFactor = CUBE_SCALE;
+void Cave::resizeLayers(int eye) {
+	int size = 0;
+	for (int wall = 0; wall < wallCount; wall++) size = std::max(size, wallSize[eye][wall]);
+	if (size == layerSize[eye]) return;
+
+	//Respecified in place, the framebuffers keep their attachments. Sizes only change after the
+	//hysteresis of updateWallSize(), so this is rare, but every image of the eye is lost with it.
+	layerSize[eye] = size;
+	GLState::bindTexture(0, GL_TEXTURE_2D_ARRAY, wallTexture[eye]);
+	allocateLayers(eye, GL_RGBA8);
+	GLState::bindTexture(0, GL_TEXTURE_2D_ARRAY, wallDepth[eye]);
+	allocateLayers(eye, GL_DEPTH_COMPONENT24);
+	for (int wall = 0; wall < wallCount; wall++) {
+		wallKeys[eye][wall].valid = false;
+		wallAge[eye][wall] = WALL_NEVER_RENDERED;
+	}
 }
 
-void Cave::initFrameBuffer() {
-	glGenFramebuffers(1, &FBO);
-	glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+void Cave::setScene(const SceneState & scene) {
+	cubePosition = scene.cubePosition;
+	cubeScaleFactor = scene.cubeScale;
+	displayAsLCD = scene.displayAsLCD;
+	analyticSkybox = scene.analyticSkybox;
+	reprojection = scene.reprojection;
 
-	initRenderedTexture();
+	//Presses rather than the mode itself, so the render mode benchmark keeps control while it runs
+	for (; renderModeCycles != scene.renderModeCycles; renderModeCycles++) cycleRenderMode();
 }
 
-void Cave::initRenderedTexture() {
-	glGenTextures(1, &renderedTexture);
-	glBindTexture(GL_TEXTURE_2D, renderedTexture);
+SceneState Cave::getScene() {
+	SceneState scene;
+	scene.cubePosition = cubePosition;
+	scene.cubeScale = cubeScaleFactor;
+	scene.displayAsLCD = displayAsLCD;
+	scene.analyticSkybox = analyticSkybox;
+	scene.reprojection = reprojection;
+	scene.renderModeCycles = renderModeCycles;
+	return scene;
+}
 
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, TEX_WIDTH, TEX_HEIGHT, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+void Cave::addDebugLines(glm::vec3 eyepos, int eye) {
+	//Eye to every wall corner
+	glm::vec3 rgb = (eye == 0) ? glm::vec3(COLOR_GREEN) : glm::vec3(COLOR_RED);
+	for (int wall = 0; wall < wallCount; wall++) {
+		for (int i = 0; i < 4; i++) DebugDraw::line(eyepos, geometry->getCorner(wall, i), rgb);
+	}
+}
 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+void Cave::renderWalls() {
+	PROFILE_SCOPE("cave walls");
+	//Remember the eye framebuffer so it can be restored after the wall passes
+	GLuint targetFBO = GLState::getDrawFramebuffer();
+
+	CaveStats last = stats;
+	stats = CaveStats();
+	stats.gpuTime = last.gpuTime;
+	stats.wallGpuTime = last.wallGpuTime;
+
+	readGpuTimes();
+	updateBenchmark(last);
+
+	//Off-axis projections of every wall for both eyes
+	geometry->updateProjections(eyePos, NEAR_PLANE, FAR_PLANE);
+
+	//Phase 1: render every wall image of both eyes. Nothing samples these until draw(),
+	//so the passes no longer wait on each other. Walls outside the eye frustum are skipped,
+	//and walls whose inputs did not change keep last frame's image.
+	WallKey keys[2];
+	int staleMask[2] = { 0, 0 };
+	for (int eye = 0; eye < 2; eye++) {
+		keys[eye] = currentWallKey(eye);
+
+		//Visibility and render size of every wall, then the eye's layers follow its largest wall
+		for (int wall = 0; wall < wallCount; wall++) {
+			wallVisible[eye][wall] = isWallVisible(eye, wall);
+			wallPriority[eye][wall] = wallVisible[eye][wall] ? getWallPriority(eye, wall) : -2.0f;
+			if (!wallVisible[eye][wall]) {
+				stats.culledWalls++;
+				continue;
+			}
+
+			//Stencil mode has no wall images, the walls are drawn in draw()
+			if (renderMode != CAVE_RENDER_STENCIL) updateWallSize(eye, wall);
+		}
+		if (renderMode == CAVE_RENDER_STENCIL) continue;
+		resizeLayers(eye);
+
+		//Bit per wall that is visible and stale
+		for (int wall = 0; wall < wallCount; wall++) {
+			if (!wallVisible[eye][wall]) continue;
+			if (wallAge[eye][wall] < WALL_NEVER_RENDERED) wallAge[eye][wall]++;
+			if (isWallCached(eye, wall, keys[eye])) stats.cachedWalls++;
+			else if (canReproject(eye, wall, keys[eye])) stats.reprojectedWalls++;
+			else staleMask[eye] |= (1 << wall);
+		}
+	}
 
-	initDepthBuffer();
+	//Stale walls that fit the GPU budget this frame, the others keep showing their old image
+	int renderMask[2];
+	scheduler.schedule(staleMask, wallPriority, wallAge, wallCount, renderMask);
+
+	for (int eye = 0; eye < 2; eye++) {
+		WallKey key = keys[eye];
+		int wallMask = renderMask[eye];
+		for (int wall = 0; wall < wallCount; wall++) {
+			if ((staleMask[eye] & (1 << wall)) && !(wallMask & (1 << wall))) stats.deferredWalls++;
+		}
+		if (wallMask == 0) continue;
+
+		if (renderMode == CAVE_RENDER_LAYERED) {
+			//One pass for every stale wall, the geometry shader drops the others
+			PROFILE_SCOPE(eye == EYE_LEFT ? "cave walls layered L" : "cave walls layered R");
+			doLayeredFrameBuffer(eye, wallMask);
+		}
+		else {
+			for (int wall = 0; wall < wallCount; wall++) {
+				if (!(wallMask & (1 << wall))) continue;
+				PROFILE_SCOPE_INDEXED(eye == EYE_LEFT ? "cave wall L" : "cave wall R", wall);
+				doFrameBuffer(eye, wall);
+			}
+		}
+
+		for (int wall = 0; wall < wallCount; wall++) {
+			if (wallMask & (1 << wall)) {
+				wallKeys[eye][wall] = key;
+				wallAge[eye][wall] = 0;
+				wallKeys[eye][wall].size = wallSize[eye][wall];
+				stats.wallPasses++;
+			}
+		}
+	}
 
-	glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, renderedTexture, 0);
+	GLState::bindFramebuffer(GL_FRAMEBUFFER, targetFBO);
 
-	//GLenum DrawBuffers[1] = { GL_COLOR_ATTACHMENT0 };
-	//glDrawBuffers(1, DrawBuffers);
+	unsigned int frame = Profiler::getFrame();
+	timedPasses[frame % PROFILER_FRAMES] = stats.wallPasses;
+	timedPassFrame[frame % PROFILER_FRAMES] = frame;
+}
 
-	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-		std::cerr << "=== SOMETHING WENT WRONG ===" << std::endl;
+void Cave::draw(glm::mat4 headPose, glm::mat4 projection, int eye) {
+	//Phase 2 in stencil mode: draw the scene through each wall directly. Each wall needs a queue of
+	//its own, so this comes before the eye's; the wall depth it leaves behind hides the skybox there.
+	if (renderMode != CAVE_RENDER_STENCIL) return;
+	GLState::viewport((GLint)viewport[eye].x, (GLint)viewport[eye].y, (GLsizei)viewport[eye].z, (GLsizei)viewport[eye].w);
+	Shaders::setCamera(headPose, projection);
+	for (int wall = 0; wall < wallCount; wall++) {
+		if (!wallVisible[eye][wall]) continue;
+		drawWallStencil(headPose, projection, eye, wall);
+		stats.wallPasses++;
+	}
 }
 
-void Cave::initDepthBuffer() {
-	glGenRenderbuffers(1, &rboId);
-	glBindRenderbuffer(GL_RENDERBUFFER, rboId);
+void Cave::submit(int eye) {
+	//Phase 2 otherwise: the wall quads (renderWalls() must have run this frame), drawn with the
+	//rest of the eye's scene so they sort ahead of the skybox
+	if (renderMode == CAVE_RENDER_STENCIL) return;
+	writeEyeBlock(eye);
+	const ShaderProgram & shader = setupComposite(eye);
+	for (int wall = 0; wall < wallCount; wall++) {
+		if (wallVisible[eye][wall]) submitWall(shader, eye, wall);
+	}
+}
 
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, TEX_WIDTH, TEX_HEIGHT);
+void Cave::drawWallStencil(glm::mat4 headPose, glm::mat4 projection, int eye, int wall) {
+	const ShaderProgram & colorShader = Shaders::getColorShader();
+	glm::mat4 m = glm::mat4(1.0f);
+	GLint ref = wall + 1;
+
+	//Mark the visible part of the wall (anything already in front of it, such as debug lines, keeps its pixels)
+	GLState::enable(GL_STENCIL_TEST);
+	glStencilMask(0xFF);
+	glStencilFunc(GL_ALWAYS, ref, 0xFF);
+	glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+	GLState::colorMask(GL_FALSE);
+	GLState::depthMask(GL_FALSE);
+	planes[wall]->draw(colorShader, m, glm::vec3(0));
+
+	//Push the marked pixels to the far plane so the scene behind the wall can fill them
+	glStencilFunc(GL_EQUAL, ref, 0xFF);
+	glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+	GLState::depthMask(GL_TRUE);
+	GLState::depthFunc(GL_ALWAYS);
+	glDepthRange(1.0, 1.0);
+	planes[wall]->draw(colorShader, m, glm::vec3(0));
+	glDepthRange(0.0, 1.0);
+	GLState::depthFunc(GL_LESS);
+	GLState::colorMask(GL_TRUE);
+
+	//Draw the scene straight into the footprint
+	RenderQueue::begin(glm::mat4(1.0f), getDirectProjection(headPose, projection, eye, wall));
+	submitCubes(Shaders::getTextureShader());
+	if (eye == 0)	skyboxL->submit(Shaders::getSkyboxShader());
+	else			skyboxR->submit(Shaders::getSkyboxShader());
+	RenderQueue::flush();
+
+	//Put the wall's own depth back for whatever is drawn after the cave
+	Shaders::setCamera(headPose, projection);
+	GLState::colorMask(GL_FALSE);
+	GLState::depthFunc(GL_ALWAYS);
+	planes[wall]->draw(colorShader, m, glm::vec3(0));
+	GLState::depthFunc(GL_LESS);
+	GLState::colorMask(GL_TRUE);
+
+	GLState::disable(GL_STENCIL_TEST);
+}
+
+glm::mat4 Cave::getDirectProjection(glm::mat4 headPose, glm::mat4 projection, int eye, int wall) {
+	//World -> wall NDC (tracked eye's off-axis frustum) -> point on the wall -> HMD eye clip space
+	const glm::mat4 & offAxis = geometry->getProjection(eye, wall);
+	glm::mat4 eyeFromWall = projection * headPose;
+	glm::mat4 direct = eyeFromWall * geometry->getWallFromNDC(wall) * offAxis;
+
+	//The wall flattens depth, so take it from the off-axis frustum instead. Every fragment of
+	//a pixel lies on the same wall point and shares its HMD w, so scaling keeps them ordered;
+	//the nearest wall corner's w keeps depth inside the clip range.
+	float minW = FLT_MAX;
+	for (int i = 0; i < 4; i++) {
+		glm::vec4 clip = eyeFromWall * glm::vec4(geometry->getCorner(wall, i), 1.0f);
+		minW = std::min(minW, clip.w);
+	}
+	float depthScale = std::max(minW, NEAR_PLANE);
+	for (int col = 0; col < 4; col++) direct[col][2] = offAxis[col][2] * depthScale;
 
-	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rboId);
+	return direct;
 }
 
-void Cave::update(double deltaTime) {
+void Cave::readGpuTimes() {
+	//Walls and both eye passes of one frame, the newest the Profiler has all three of
+	float walls, left, right;
+	unsigned int frame, leftFrame, rightFrame;
+	if (!Profiler::getGpuTime("cave walls", walls, frame) || frame == timedFrame) return;
+	if (!Profiler::getGpuTime(CAVE_EYE_PASS_STAGE(EYE_LEFT), left, leftFrame) || leftFrame != frame) return;
+	if (!Profiler::getGpuTime(CAVE_EYE_PASS_STAGE(EYE_RIGHT), right, rightFrame) || rightFrame != frame) return;
+
+	timedFrame = frame;
+	stats.wallGpuTime = walls;
+	stats.gpuTime = walls + left + right;
+	if (timedPassFrame[frame % PROFILER_FRAMES] == frame) scheduler.reportCost(walls, timedPasses[frame % PROFILER_FRAMES]);
+}
+
+void Cave::benchmarkRenderModes() {
+	if (benchmarkFrame >= 0) return;
 
+	for (int mode = 0; mode < CAVE_RENDER_MODES; mode++) {
+		benchmarkTime[mode] = 0.0;
+		benchmarkPasses[mode] = 0;
+		benchmarkSamples[mode] = 0;
+	}
+	benchmarkRestore = renderMode;
+	benchmarkFrame = 0;
+	std::cout << "Benchmarking cave render modes (" << BENCHMARK_FRAMES << " frames each)..." << std::endl;
 }
 
-void Cave::drawDebugLines(glm::mat4 headPose, glm::mat4 projection, glm::vec3 eyepos, int eye) {
-	lines->updateEyePos(eyepos);
-	if (eye == 0)	lines->draw(projection, headPose, Shaders::getColorShader(), glm::mat4(1), glm::vec3(COLOR_GREEN));
-	else			lines->draw(projection, headPose, Shaders::getColorShader(), glm::mat4(1), glm::vec3(COLOR_RED));
+void Cave::updateBenchmark(const CaveStats & last) {
+	if (benchmarkFrame < 0) return;
+
+	//Last frame's counters belong to the mode that was active then
+	int mode = benchmarkFrame / BENCHMARK_FRAMES;
+	if (benchmarkFrame > 0 && (benchmarkFrame - 1) % BENCHMARK_FRAMES >= BENCHMARK_WARMUP) {
+		int lastMode = (benchmarkFrame - 1) / BENCHMARK_FRAMES;
+		benchmarkTime[lastMode] += stats.gpuTime;
+		benchmarkPasses[lastMode] += last.wallPasses;
+		benchmarkSamples[lastMode]++;
+	}
+
+	if (mode >= CAVE_RENDER_MODES) {
+		for (int m = 0; m < CAVE_RENDER_MODES; m++) {
+			int n = std::max(benchmarkSamples[m], 1);
+			std::cout << getRenderModeName((CaveRenderMode)m) << ":\tGPU " << benchmarkTime[m] / n << " ms/frame,\twall passes " << (double)benchmarkPasses[m] / n << "/frame" << std::endl;
+		}
+		renderMode = benchmarkRestore;
+		benchmarkFrame = -1;
+		return;
+	}
+
+	renderMode = (CaveRenderMode)mode;
+	benchmarkFrame++;
 }
 
-void Cave::draw(glm::mat4 headPose, glm::mat4 projection, int eye) {
-	//Set rotation matrix
-	glm::mat4 m = glm::mat4(1.0f) * rotation;
-
-	//LEFT PLANE
-	{
-		//Draw to framebuffer 
-		doFrameBuffer(generateProjection(eye, 0), eye);
-
-		//Draw texture for LEFT plane
-		glBindFramebuffer(GL_FRAMEBUFFER, 1);
-		glViewport((GLint)viewport[eye].x, (GLint)viewport[eye].y, (GLsizei)viewport[eye].z, (GLsizei)viewport[eye].w);
-		if(displayAsLCD) planeL->draw(projection, headPose, Shaders::getLCDisplayShader(), m, renderedTexture, getDisplayNormal(0), eyePos[eye]);
-		else planeL->draw(projection, headPose, Shaders::getRenderedTextureShader(), m, renderedTexture, eyePos[eye]);
-		glClearDepth(rboId);
+const char * Cave::getRenderModeName(CaveRenderMode mode) {
+	switch (mode) {
+	case CAVE_RENDER_LAYERED: return "layered";
+	case CAVE_RENDER_STENCIL: return "stencil";
+	default: return "texture";
 	}
-	//RIGHT PLANE
-	{
-		//Draw to framebuffer 
-		doFrameBuffer(generateProjection(eye, 1), eye);
-
-		//Draw texture for RIGHT plane
-		glBindFramebuffer(GL_FRAMEBUFFER, 1);
-		glViewport((GLint)viewport[eye].x, (GLint)viewport[eye].y, (GLsizei)viewport[eye].z, (GLsizei)viewport[eye].w);
-		if(displayAsLCD) planeR->draw(projection, headPose, Shaders::getLCDisplayShader(), m, renderedTexture, getDisplayNormal(1), eyePos[eye]);
-		else planeR->draw(projection, headPose, Shaders::getRenderedTextureShader(), m, renderedTexture, eyePos[eye]);
-		glClearDepth(rboId);
+}
+
+float Cave::getWallPriority(int eye, int wall) {
+	//Cosine between the view direction and the direction to the wall center
+	glm::mat4 camera = glm::inverse(eyeView[eye]);
+	glm::vec3 forward = -glm::vec3(camera[2]);
+	glm::vec3 center = (geometry->getCorner(wall, 0) + geometry->getCorner(wall, 2)) * 0.5f;
+	return glm::dot(glm::normalize(forward), glm::normalize(center - glm::vec3(camera[3])));
+}
+
+bool Cave::isWallVisible(int eye, int wall) {
+	//Wall corners
+	glm::vec3 quad[4];
+	for (int i = 0; i < 4; i++) quad[i] = geometry->getCorner(wall, i);
+
+	//Facing away from the HMD (the composite quad would be back-face culled anyway)
+	glm::vec3 camera = glm::inverse(eyeView[eye])[3];
+	if (glm::dot(geometry->getNormal(wall), camera - quad[0]) <= 0.0f) return false;
+
+	//Fully outside one of the frustum planes
+	glm::mat4 viewProjection = eyeProjection[eye] * eyeView[eye];
+	glm::vec4 clip[4];
+	for (int i = 0; i < 4; i++) clip[i] = viewProjection * glm::vec4(quad[i], 1.0f);
+
+	for (int axis = 0; axis < 3; axis++) {
+		bool allBelow = true;
+		bool allAbove = true;
+		for (int i = 0; i < 4; i++) {
+			allBelow = allBelow && (clip[i][axis] < -clip[i].w);
+			allAbove = allAbove && (clip[i][axis] > clip[i].w);
+		}
+		if (allBelow || allAbove) return false;
 	}
-	//BOTTOM PLANE
-	{
-		//Draw to framebuffer 
-		doFrameBuffer(generateProjection(eye, 2), eye);
-
-		//Draw texture for BOTTOM plane
-		glBindFramebuffer(GL_FRAMEBUFFER, 1);
-		glViewport((GLint)viewport[eye].x, (GLint)viewport[eye].y, (GLsizei)viewport[eye].z, (GLsizei)viewport[eye].w);
-		if(displayAsLCD) planeB->draw(projection, headPose, Shaders::getLCDisplayShader(), m, renderedTexture, getDisplayNormal(2), eyePos[eye]);
-		else planeB->draw(projection, headPose, Shaders::getRenderedTextureShader(), m, renderedTexture, eyePos[eye]);
-		glClearDepth(rboId);
+
+	return true;
+}
+
+float Cave::getWallFootprint(int eye, int wall) {
+	float viewportArea = viewport[eye].z * viewport[eye].w;
+
+	//Wall corners in winding order
+	glm::vec3 quad[4];
+	for (int i = 0; i < 4; i++) quad[i] = geometry->getCorner(wall, i);
+
+	//Project into eye viewport pixels
+	glm::mat4 viewProjection = eyeProjection[eye] * eyeView[eye];
+	glm::vec2 pixels[4];
+	for (int i = 0; i < 4; i++) {
+		glm::vec4 clip = viewProjection * glm::vec4(quad[i], 1.0f);
+
+		//A corner behind the eye means the wall surrounds the viewer
+		if (clip.w <= NEAR_PLANE) return viewportArea;
+
+		glm::vec2 ndc = glm::vec2(clip.x / clip.w, clip.y / clip.w);
+		pixels[i] = glm::vec2((ndc.x * 0.5f + 0.5f) * viewport[eye].z, (ndc.y * 0.5f + 0.5f) * viewport[eye].w);
 	}
+
+	//Shoelace area, capped to the viewport
+	float area = 0.0f;
+	for (int i = 0; i < 4; i++) {
+		glm::vec2 a = pixels[i];
+		glm::vec2 b = pixels[(i + 1) % 4];
+		area += a.x * b.y - b.x * a.y;
+	}
+	area = std::abs(area) * 0.5f;
+
+	return std::min(area, viewportArea);
 }
 
-void Cave::doFrameBuffer(glm::mat4 projection, int eye) {
-	//Bind Framebuffer
-	glBindFramebuffer(GL_FRAMEBUFFER, FBO);
-	glViewport(0, 0, TEX_WIDTH, TEX_HEIGHT);
-	glFlush();
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+void Cave::updateWallSize(int eye, int wall) {
+	//Texels per side needed to cover the footprint one-to-one
+	float needed = std::sqrt(getWallFootprint(eye, wall));
 
-	//Draw Cube
-	cube->toWorld = glm::translate(glm::mat4(1.0f), cubePosition) * glm::scale(glm::mat4(1.0f), cubeScaleFactor);
-	cube->draw(projection, glm::mat4(1.0f), Shaders::getTextureShader(), glm::mat4(1.0f));
+	//Smallest pooled size that covers it
+	int target = WALL_SIZES[WALL_SIZE_COUNT - 1];
+	for (int i = 0; i < WALL_SIZE_COUNT; i++) {
+		if (WALL_SIZES[i] >= needed) { target = WALL_SIZES[i]; break; }
+	}
 
-	//Draw Skybox
-	if (eye == 0)	skyboxL->draw(projection, glm::mat4(1.0f), Shaders::getSkyboxShader());
-	else			skyboxR->draw(projection, glm::mat4(1.0f), Shaders::getSkyboxShader());
+	int & current = wallSize[eye][wall];
+
+	//Grow right away so the wall never looks blurry
+	if (target > current) {
+		current = target;
+		wallDowngrade[eye][wall] = 0;
+		return;
+	}
+
+	//Shrink only when the smaller size fits comfortably for a while
+	if (target < current && needed < (current / 2) * WALL_SIZE_HYSTERESIS) {
+		if (++wallDowngrade[eye][wall] >= WALL_SIZE_DOWNGRADE_FRAMES) {
+			current = current / 2;
+			wallDowngrade[eye][wall] = 0;
+		}
+	}
+	else wallDowngrade[eye][wall] = 0;
 }
 
-glm::mat4 Cave::generateProjection(int eye, int plane) {
-	int cornerIndex = 3 * plane;
+Cave::WallKey Cave::currentWallKey(int eye) {
+	WallKey key;
+	key.valid = true;
+	key.eyePos = eyePos[eye];
+	key.cubePosition = cubePosition;
+	key.cubeScale = cubeScaleFactor;
+	key.cubeCount = cubeCount;
+	key.skybox = (eye == 0) ? skyboxL : skyboxR;
+	key.displayAsLCD = displayAsLCD;
+	key.analyticSkybox = analyticSkybox;
+	return key;
+}
 
-	//Corner variables
-	glm::vec3 pa = corners[cornerIndex + 1];
-	glm::vec3 pb = corners[cornerIndex + 2];
-	glm::vec3 pc = corners[cornerIndex + 0];
-	glm::vec3 pe = eyePos[eye];
+bool Cave::isWallReusable(int eye, int wall, const WallKey & key) {
+	//Everything but the eye position matches the wall image
+	const WallKey & last = wallKeys[eye][wall];
 
-	//Init the rest of the variables
-	glm::vec3 vr, vu, vn, va, vb, vc;
-	float l, r, b, t, d;
-	glm::mat4 M_T = glm::mat4(1.0f);
-	glm::mat4 P = glm::mat4(1.0f);
-	glm::mat4 T = glm::mat4(1.0f);
+	if (!last.valid) return false;
+	if (last.skybox != key.skybox || last.displayAsLCD != key.displayAsLCD || last.analyticSkybox != key.analyticSkybox) return false;
+	if (glm::length(last.cubePosition - key.cubePosition) > CACHE_CUBE_TOLERANCE) return false;
+	if (glm::length(last.cubeScale - key.cubeScale) > CACHE_CUBE_TOLERANCE) return false;
+	if (last.cubeCount != key.cubeCount) return false;
+	if (last.size != wallSize[eye][wall]) return false;
 
-	//Calculate right, up, and normal vectors
-	vr = pb - pa;
-	vr = glm::normalize(vr);	//right
+	return true;
+}
 
-	vu = pc - pa;
-	vu = glm::normalize(vu);	//up
+bool Cave::isWallCached(int eye, int wall, const WallKey & key) {
+	if (!isWallReusable(eye, wall, key)) return false;
+	return glm::length(wallKeys[eye][wall].eyePos - key.eyePos) <= CACHE_EYE_TOLERANCE;
+}
 
-	vn = glm::cross(vr, vu);
-	vn = glm::normalize(vn);	//normal
+bool Cave::canReproject(int eye, int wall, const WallKey & key) {
+	if (!reprojection || !isWallReusable(eye, wall, key)) return false;
+	if (wallAge[eye][wall] >= REPROJECT_REFRESH_FRAMES) return false;
+	return getReprojectionError(eye, wall) <= REPROJECT_MAX_ERROR;
+}
 
-	//Get vectors from corner to eye
-	va = pa - pe;
-	vb = pb - pe;
-	vc = pc - pe;
+glm::vec3 Cave::getReprojectionPlane(int eye, int wall) {
+	//Parallel to the wall through the cube, or the wall itself when the cube is not in front of both eye positions
+	const WallKey & last = wallKeys[eye][wall];
+	glm::vec3 normal = geometry->getNormal(wall);
 
-	//Calculate distance from eye to screen plane
-	d = -(glm::dot(vn, va));
+	float renderedDepth = glm::dot(normal, last.eyePos - last.cubePosition);
+	float currentDepth = glm::dot(normal, eyePos[eye] - last.cubePosition);
+	if (renderedDepth < REPROJECT_MIN_DEPTH || currentDepth < REPROJECT_MIN_DEPTH) return geometry->getCorner(wall, 0);
 
-	//P
-	l = glm::dot(vr, va) * NEAR_PLANE / d;
-	r = glm::dot(vr, vb) * NEAR_PLANE / d;
-	b = glm::dot(vu, va) * NEAR_PLANE / d;
-	t = glm::dot(vu, vc) * NEAR_PLANE / d;
+	return last.cubePosition;
+}
 
-	P = glm::frustum(l, r, b, t, NEAR_PLANE, FAR_PLANE);
+float Cave::getReprojectionError(int eye, int wall) {
+	//Parallax left after the warp: content off the reference plane shifts on the wall by
+	//moved * wallDepth * |1/contentDepth - 1/planeDepth| (depths along the wall normal)
+	const WallKey & last = wallKeys[eye][wall];
+	glm::vec3 normal = geometry->getNormal(wall);
+
+	float moved = glm::length(eyePos[eye] - last.eyePos);
+	float wallDepth = glm::dot(normal, last.eyePos - geometry->getCorner(wall, 0));
+	float planeDepth = glm::dot(normal, last.eyePos - getReprojectionPlane(eye, wall));
+	float planeInverse = 1.0f / std::max(planeDepth, NEAR_PLANE);
+
+	//Inverse depth range of what the image holds (the skybox is at infinity)
+	float radius = last.cubeScale.x * CUBE_RADIUS;
+	float cubeDepth = glm::dot(normal, last.eyePos - last.cubePosition);
+	bool cubeInImage = cubeDepth + radius > NEAR_PLANE;
+	float nearInverse = cubeInImage ? 1.0f / std::max(cubeDepth - radius, NEAR_PLANE) : planeInverse;
+	float farInverse = last.analyticSkybox ? (cubeInImage ? 1.0f / (cubeDepth + radius) : planeInverse) : 0.0f;
+
+	float shift = moved * wallDepth * std::max(std::abs(nearInverse - planeInverse), std::abs(farInverse - planeInverse));
+
+	//Meters on the wall to texels of the wall image
+	float texelsPerMeter = wallSize[eye][wall] / std::min(geometry->getWidth(wall), geometry->getHeight(wall));
+	return shift * texelsPerMeter;
+}
 
-	//M_T (manually set all elements)
-	M_T[0][0] = vr.x; M_T[1][0] = vr.y; M_T[2][0] = vr.z; M_T[3][0] = 0;
-	M_T[0][1] = vu.x; M_T[1][1] = vu.y; M_T[2][1] = vu.z; M_T[3][1] = 0;
-	M_T[0][2] = vn.x; M_T[1][2] = vn.y; M_T[2][2] = vn.z; M_T[3][2] = 0;
-	M_T[0][3] = 0;    M_T[1][3] = 0;    M_T[2][3] = 0;    M_T[3][3] = 1;
+void Cave::writeEyeBlock(int eye) {
+	//Written right before the composite reads it, from the eye pose latched for this pass
+	CaveEyeBlock block;
+	block.eyePos = glm::vec4(eyePos[eye], 1.0f);
 
-	//T
-	T[3] = glm::vec4(-pe, 1.0f);
+	//Warp each image from the eye position it was rendered at to the current one
+	for (int wall = 0; wall < MAX_WALLS; wall++) {
+		block.warps[wall] = glm::mat4(1.0f);
+		if (wall >= wallCount || !reprojection || !wallVisible[eye][wall]) continue;
+		block.warps[wall] = glm::mat4(geometry->getReprojection(wall, wallKeys[eye][wall].eyePos, eyePos[eye], getReprojectionPlane(eye, wall)));
+	}
 
-	//Generalized perspective projection
-	return P * M_T * T;
+	//Orphaned on every write, so updating it never waits on a pass still reading the old contents
+	glBindBuffer(GL_UNIFORM_BUFFER, eyeBlock[eye]);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(block), &block, GL_STREAM_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	glBindBufferBase(GL_UNIFORM_BUFFER, CAVE_EYE_BINDING, eyeBlock[eye]);
 }
 
-glm::vec3 Cave::getDisplayNormal(int plane) {
-	int cornerIndex = 3 * plane;
+const ShaderProgram & Cave::setupComposite(int eye) {
+	//Uniforms every wall of the eye shares, set once on the program before the walls are queued
+	const ShaderProgram & shader = displayAsLCD ? Shaders::getLCDisplayShader() : Shaders::getRenderedTextureShader();
+	shader.use();
+
+	//Skybox seen through the wall, traced from the tracked eye
+	glUniform1i(shader.get(UNIFORM_ANALYTIC_SKYBOX), analyticSkybox);
+	if (analyticSkybox) {
+		Skybox * skybox = (eye == 0) ? skyboxL : skyboxR;
+		glUniform1f(shader.get(UNIFORM_SKYBOX_EXTENT), SKYBOX_EXTENT);
+		GLState::bindTexture(1, GL_TEXTURE_CUBE_MAP, skybox->getTextureID());
+	}
+	return shader;
+}
 
-	//Corner variables
-	glm::vec3 pa = corners[cornerIndex + 1];
-	glm::vec3 pb = corners[cornerIndex + 2];
-	glm::vec3 pc = corners[cornerIndex + 0];
+void Cave::submitWall(const ShaderProgram & shader, int eye, int wall) {
+	//Wall quads are already in world space; only the corner of the layer the wall was rendered at is sampled
+	float texScale = (float)wallKeys[eye][wall].size / layerSize[eye];
+	planes[wall]->submit(shader, glm::mat4(1.0f), wallTexture[eye], wall, geometry->getNormal(wall), texScale);
+}
 
-	//Init the rest of the variables
-	glm::vec3 vr, vu, vn;
+void Cave::doFrameBuffer(int eye, int wall) {
+	//Wall projections are built in world space
+	RenderQueue::begin(glm::mat4(1.0f), geometry->getProjection(eye, wall));
 
-	//Calculate right, up, and normal vectors
-	vr = pb - pa;
-	vr = glm::normalize(vr);	//right
+	//Bind Framebuffer
+	GLState::bindFramebuffer(GL_FRAMEBUFFER, wallFBO[eye][wall]);
+	GLState::viewport(0, 0, wallSize[eye][wall], wallSize[eye][wall]);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-	vu = pc - pa;
-	vu = glm::normalize(vu);	//up
+	//Draw Cube
+	submitCubes(Shaders::getTextureShader());
 
-	vn = glm::cross(vr, vu);
-	return glm::normalize(vn);	//normal
+	//Draw Skybox (unless the wall shader traces it)
+	if (!analyticSkybox) {
+		if (eye == 0)	skyboxL->submit(Shaders::getSkyboxShader());
+		else			skyboxR->submit(Shaders::getSkyboxShader());
+	}
+	RenderQueue::flush();
 }
 
-//Setters
-void Cave::setCubeScale(float s) { cubeScaleFactor = glm::vec3(cubeScaleFactor.x + s); }
+void Cave::doLayeredFrameBuffer(int eye, int wallMask) {
+	//Off-axis projection of every wall, indexed by gl_InvocationID in the geometry shader
+	const glm::mat4 * projections = geometry->getProjections(eye);
 
-void Cave::resetCubeScale() { cubeScaleFactor = CUBE_SCALE; }
+	//Clear only the layers that are redrawn, then bind every layer
+	for (int wall = 0; wall < wallCount; wall++) {
+		if (!(wallMask & (1 << wall))) continue;
+		GLState::bindFramebuffer(GL_FRAMEBUFFER, wallFBO[eye][wall]);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	}
+	GLState::bindFramebuffer(GL_FRAMEBUFFER, layeredFBO[eye]);
+
+	//Each wall has its own render size, selected through gl_ViewportIndex
+	for (int wall = 0; wall < wallCount; wall++) glViewportIndexedf(wall, 0, 0, (GLfloat)wallSize[eye][wall], (GLfloat)wallSize[eye][wall]);
+	GLState::forgetViewport();
+
+	//Wall projections and mask are shared by every draw, set once per program
+	const ShaderProgram * shaders[] = { &Shaders::getLayeredTextureShader(), &Shaders::getLayeredSkyboxShader() };
+	for (const ShaderProgram * shader : shaders) {
+		shader->use();
+		glUniformMatrix4fv(shader->get(UNIFORM_WALL_PROJECTIONS), wallCount, GL_FALSE, &projections[0][0][0]);
+		glUniform1i(shader->get(UNIFORM_WALL_MASK), wallMask);
+	}
 
-void Cave::moveCube(glm::vec3 t) { cubePosition += glm::vec3(t.x, t.y, -t.z); }
+	//The geometry shader applies the wall projections, the camera only places the world
+	//(so every packet has the same depth and the order falls to program, texture and mesh)
+	RenderQueue::begin(glm::mat4(1.0f), glm::mat4(1.0f));
+
+	//Draw Cube
+	submitCubes(Shaders::getLayeredTextureShader());
+
+	//Draw Skybox (unless the wall shader traces it)
+	if (!analyticSkybox) {
+		if (eye == 0)	skyboxL->submit(Shaders::getLayeredSkyboxShader());
+		else			skyboxR->submit(Shaders::getLayeredSkyboxShader());
+	}
+	RenderQueue::flush();
+}
 
-void Cave::resetCubePosition() { cubePosition = CUBE_POSITION; }
+//Setters
+void Cave::setCubeCount(int count) {
+	//Grid of side n inside the cube's own volume, so its bounds (and the reprojection error) do not change
+	cubeCount = std::max(count, 1);
+	int side = (int)std::ceil(std::cbrt((double)cubeCount) - 1e-9);
+	cubeFieldScale = (side == 1) ? 1.0f : CUBE_FIELD_FILL / side;
+
+	cubeOffsets.clear();
+	for (int i = 0; i < cubeCount; i++) {
+		glm::vec3 cell = glm::vec3((float)(i % side), (float)((i / side) % side), (float)(i / (side * side)));
+		cubeOffsets.push_back((cell + glm::vec3(0.5f)) / (float)side - glm::vec3(0.5f));
+	}
+}
+
+void Cave::submitCubes(const ShaderProgram & shader) {
+	for (int i = 0; i < cubeCount; i++) {
+		glm::vec3 position = cubePosition + cubeOffsets[i] * cubeScaleFactor;
+		cube->toWorld = glm::translate(glm::mat4(1.0f), position) * glm::scale(glm::mat4(1.0f), cubeScaleFactor * cubeFieldScale);
+		cube->submit(shader, glm::mat4(1.0f));
+	}
+}
@@ -4,44 +4,159 @@
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 
+#include "CaveGeometry.h"
+#include "WallScheduler.h"
+#include "SceneState.h"
+#include "ShaderProgram.h"
+#include "Profiler.h"
+
+#include <vector>
+
+class Skybox;
+
+//How the walls reach the eye buffer
+enum CaveRenderMode {
+	CAVE_RENDER_TEXTURE,	//one render-to-texture pass per wall, then a textured quad
+	CAVE_RENDER_LAYERED,	//every wall texture in a single layered pass, then a textured quad
+	CAVE_RENDER_STENCIL,	//no texture, the scene is drawn straight into the wall's stencilled footprint
+	CAVE_RENDER_MODES
+};
+
+//Profiler stage of an eye pass: the caller times draw(), submit() and the flush of the eye's queue with it
+#define CAVE_EYE_PASS_STAGE(eye) ((eye) == 0 ? "eye pass L" : "eye pass R")
+
+//Per-frame wall pass counters
+struct CaveStats {
+	int wallPasses = 0;		//wall images rendered (walls drawn directly in stencil mode)
+	int culledWalls = 0;	//skipped because the wall cannot contribute pixels
+	int cachedWalls = 0;	//skipped because the previous image is still valid
+	int reprojectedWalls = 0;	//skipped because the previous image can be warped to the new eye position
+	int deferredWalls = 0;	//stale, but left for a later frame by the scheduler
+	float gpuTime = 0.0f;	//milliseconds spent in the wall passes and the eye passes they are composited in, of the newest frame the Profiler has them for
+	float wallGpuTime = 0.0f;	//...of which in the wall passes
+};
+
 class Cave{
 public:
 	Cave();
+	Cave(const char * configPath);
 	~Cave();
 
-	void draw(glm::mat4 headPose, glm::mat4 projection, int eye);
-	void drawDebugLines(glm::mat4 headPose, glm::mat4 projection, glm::vec3 eyepos, int eye);
-	void update(double deltaTime);
+	void renderWalls();
+	void draw(glm::mat4 headPose, glm::mat4 projection, int eye);	//stencil mode: the walls straight into the eye buffer, before the eye's queue is begun
+	void submit(int eye);	//other modes: the wall quads, to the eye's queue (RenderQueue::begin() with the eye camera)
+	void addDebugLines(glm::vec3 eyepos, int eye);	//queued on DebugDraw
+	void setScene(const SceneState & scene);	//cube and display toggles, as published by the simulation
+	SceneState getScene();						//the cave's current values, to start a simulation from
 
 	//Setters
 	void setEyePos(glm::vec3 pos, int eye) { eyePos[eye] = pos; }
 	void setViewport(glm::vec4 vp, int eye) { viewport[eye] = vp; }
-	void setCubeScale(float s);
-	void resetCubeScale();
-	void moveCube(glm::vec3 t);
-	void resetCubePosition();
-	void toggleLCD(){ displayAsLCD = !displayAsLCD; }
+	void setEyeCamera(glm::mat4 headPose, glm::mat4 projection, int eye) { eyeView[eye] = headPose; eyeProjection[eye] = projection; }
+	void setCubeCount(int count);
+	void cycleRenderMode() { renderMode = (CaveRenderMode)((renderMode + 1) % CAVE_RENDER_MODES); }
+	void benchmarkRenderModes();
+	void setWallBudget(float ms) { scheduler.setBudget(ms); }
+
+	//Getters
+	CaveStats getStats() { return stats; }
+	CaveRenderMode getRenderMode() { return renderMode; }
+	int getWallCount() { return wallCount; }
+	static const char * getRenderModeName(CaveRenderMode mode);
 
 private:
+	//Everything a wall image depends on. A wall is only re-rendered when its key changes.
+	struct WallKey {
+		bool valid = false;
+		glm::vec3 eyePos = glm::vec3(0.0f);
+		glm::vec3 cubePosition = glm::vec3(0.0f);
+		glm::vec3 cubeScale = glm::vec3(0.0f);
+		int cubeCount = 0;
+		Skybox * skybox = NULL;
+		bool displayAsLCD = false;
+		bool analyticSkybox = false;
+		int size = 0;
+	};
+
+	//std140 layout of the CaveEye uniform block (bound at CAVE_EYE_BINDING, the camera comes from Shaders::setCamera)
+	struct CaveEyeBlock {
+		glm::vec4 eyePos;
+		glm::mat4 warps[MAX_WALLS];		//wall image reprojection in the upper 3x3
+	};
+
 	glm::mat4 toWorld = glm::mat4(1.0f);
-	GLuint FBO, rboId, renderedTexture;
+	GLuint wallFBO[2][MAX_WALLS];		//one FBO per eye and layer, used by the per-wall passes
+	GLuint layeredFBO[2];				//all layers of an eye attached, used by the single layered pass
+	GLuint wallTexture[2], wallDepth[2];	//2D texture arrays per eye, one layer per wall
+	GLuint eyeBlock[2];					//CaveEye uniform buffer per eye
 	glm::vec3 eyePos[2] = { glm::vec3(1.0f), glm::vec3(1.0f) };
 	glm::vec4 viewport[2] = { glm::vec4(1.0f), glm::vec4(1.0f) };
+	glm::mat4 eyeView[2] = { glm::mat4(1.0f), glm::mat4(1.0f) };
+	glm::mat4 eyeProjection[2] = { glm::mat4(1.0f), glm::mat4(1.0f) };
+	bool wallVisible[2][MAX_WALLS];
+	int wallSize[2][MAX_WALLS];		//render resolution currently used by each wall
+	int wallDowngrade[2][MAX_WALLS];	//consecutive frames a wall asked for a smaller size
+	int layerSize[2];				//allocated size of every layer of the eye's wall arrays, its largest wall size
+	CaveStats stats;
 	bool displayAsLCD = true;
+	CaveRenderMode renderMode = CAVE_RENDER_TEXTURE;
+	unsigned int renderModeCycles = 0;	//render mode presses of the simulation applied so far
+	bool analyticSkybox = true;		//walls sample the skybox themselves, the wall passes only draw near geometry
+	bool reprojection = true;		//warp old wall images to small eye movements instead of re-rendering
+	int wallAge[2][MAX_WALLS];		//frames since each wall image was rendered
+	float wallPriority[2][MAX_WALLS];	//how close each wall is to the view direction (-1 to 1, lower when culled)
+	WallScheduler scheduler;
+	int wallCount = 0;
+	WallKey wallKeys[2][MAX_WALLS];
+
+	//Cube field: the cube's volume split into a grid of smaller cubes (one cube by default)
+	int cubeCount = 1;
+	std::vector<glm::vec3> cubeOffsets;		//centers, in units of the cube scale
+	float cubeFieldScale = 1.0f;			//size of each cube, in units of the cube scale
+
+	//GPU timing, from the Profiler stages of renderWalls() and draw(). Wall passes of the frames
+	//whose times are still on their way, to pair them with the wall time once it arrives.
+	int timedPasses[PROFILER_FRAMES] = { 0 };
+	unsigned int timedPassFrame[PROFILER_FRAMES] = { 0 };
+	unsigned int timedFrame = 0;	//frame the current GPU times are from
+
+	//Side by side benchmark of the render modes (benchmarkFrame < 0 when idle)
+	int benchmarkFrame = -1;
+	CaveRenderMode benchmarkRestore = CAVE_RENDER_TEXTURE;
+	double benchmarkTime[CAVE_RENDER_MODES];
+	int benchmarkPasses[CAVE_RENDER_MODES];
+	int benchmarkSamples[CAVE_RENDER_MODES];
 
 	void initPlanes();
-	void initCorners();
-	void initLines();
 	void initSkybox();
 	void initObjects();
 	void initFrameBuffer();
-	void initRenderedTexture();
-	void initDepthBuffer();
+	void initRenderedTexture(int eye);
+	void initDepthBuffer(int eye);
+	void initSamplers();
+	void allocateLayers(int eye, GLenum format);
+	void resizeLayers(int eye);
 
-	void doFrameBuffer(glm::mat4 projection, int eye);
-	glm::mat4 generateProjection(int eye, int plane);
-	glm::vec3 getDisplayNormal(int plane);
+	void doFrameBuffer(int eye, int wall);
+	void doLayeredFrameBuffer(int eye, int wallMask);
+	void submitCubes(const ShaderProgram & shader);	//to the RenderQueue
+	bool isWallVisible(int eye, int wall);
+	float getWallPriority(int eye, int wall);
+	float getWallFootprint(int eye, int wall);
+	void updateWallSize(int eye, int wall);
+	WallKey currentWallKey(int eye);
+	bool isWallReusable(int eye, int wall, const WallKey & key);
+	bool isWallCached(int eye, int wall, const WallKey & key);
+	bool canReproject(int eye, int wall, const WallKey & key);
+	float getReprojectionError(int eye, int wall);
+	glm::vec3 getReprojectionPlane(int eye, int wall);
+	void writeEyeBlock(int eye);
+	const ShaderProgram & setupComposite(int eye);
+	void submitWall(const ShaderProgram & shader, int eye, int wall);
+	void drawWallStencil(glm::mat4 headPose, glm::mat4 projection, int eye, int wall);
+	glm::mat4 getDirectProjection(glm::mat4 headPose, glm::mat4 projection, int eye, int wall);
+	void readGpuTimes();
+	void updateBenchmark(const CaveStats & last);
 };
 
 #endif
-
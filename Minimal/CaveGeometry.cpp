@@ -0,0 +1,193 @@
+#include "CaveGeometry.h"
+#include "Definitions.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//Central projection from a point onto the plane through planePoint with the given normal (homogeneous)
+static glm::mat4 projectOntoPlane(glm::vec3 from, glm::vec3 normal, glm::vec3 planePoint) {
+	glm::vec4 plane = glm::vec4(normal, -glm::dot(normal, planePoint));
+	glm::vec4 e = glm::vec4(from, 1.0f);
+
+	glm::mat4 m = glm::mat4(glm::dot(plane, e));
+	for (int col = 0; col < 4; col++) {
+		for (int row = 0; row < 4; row++) m[col][row] -= e[row] * plane[col];
+	}
+	return m;
+}
+
+CaveGeometry::CaveGeometry(const char * path) {
+	parse(path);
+
+	projections[0].resize(origins.size(), glm::mat4(1.0f));
+	projections[1].resize(origins.size(), glm::mat4(1.0f));
+}
+
+CaveGeometry::~CaveGeometry() {
+	origins.clear();
+	rights.clear();
+	ups.clear();
+	normals.clear();
+	widths.clear();
+	heights.clear();
+	bases.clear();
+	projections[0].clear();
+	projections[1].clear();
+}
+
+void CaveGeometry::parse(const char * path) {
+	// Config lines:
+	//   rotate <degrees>                       yaw applied to every following wall
+	//   wall <lower-left> <lower-right> <upper-left>   three xyz corners of a rectangle
+	FILE * file;
+	char keyword[64];
+	glm::mat4 rotation = glm::mat4(1.0f);
+
+	std::cout << "    Reading " << path << "\n";
+
+	file = fopen(path, "r");
+
+	if (file == NULL) {
+		std::cerr << "error loading file" << std::endl;
+		exit(-1);
+	}
+
+	while (fscanf(file, "%63s", keyword) == 1) {
+		if (keyword[0] == '#') {
+			int c = fgetc(file);
+			while (c != '\n' && c != EOF) c = fgetc(file);
+		}
+		else if (strcmp(keyword, "rotate") == 0) {
+			float degrees = 0.0f;
+			fscanf(file, "%f", &degrees);
+			rotation = glm::rotate(glm::mat4(1.0f), degrees * MATH_PI / 180.0f, glm::vec3(0, 1, 0));
+		}
+		else if (strcmp(keyword, "wall") == 0) {
+			glm::vec3 p[3];
+			for (int i = 0; i < 3; i++) fscanf(file, "%f %f %f", &p[i].x, &p[i].y, &p[i].z);
+			for (int i = 0; i < 3; i++) p[i] = glm::vec3(rotation * glm::vec4(p[i], 1.0f));
+
+			if (origins.size() < MAX_WALLS) addWall(p[0], p[1], p[2]);
+			else std::cerr << "\tIgnoring wall, at most " << MAX_WALLS << " walls are supported" << std::endl;
+		}
+		else {
+			std::cerr << "\tUnknown keyword in " << path << ": " << keyword << std::endl;
+		}
+	}
+
+	fclose(file);
+
+	std::cout << "\t" << path << ", walls: " << origins.size() << std::endl;
+}
+
+void CaveGeometry::addWall(glm::vec3 pa, glm::vec3 pb, glm::vec3 pc) {
+	//Calculate right, up, and normal vectors
+	glm::vec3 vr = glm::normalize(pb - pa);
+	glm::vec3 vu = glm::normalize(pc - pa);
+	glm::vec3 vn = glm::normalize(glm::cross(vr, vu));
+
+	//M_T (rows are the wall basis)
+	glm::mat4 M_T = glm::mat4(1.0f);
+	M_T[0][0] = vr.x; M_T[1][0] = vr.y; M_T[2][0] = vr.z;
+	M_T[0][1] = vu.x; M_T[1][1] = vu.y; M_T[2][1] = vu.z;
+	M_T[0][2] = vn.x; M_T[1][2] = vn.y; M_T[2][2] = vn.z;
+
+	origins.push_back(pa);
+	rights.push_back(vr);
+	ups.push_back(vu);
+	normals.push_back(vn);
+	widths.push_back(glm::length(pb - pa));
+	heights.push_back(glm::length(pc - pa));
+	bases.push_back(M_T);
+}
+
+void CaveGeometry::updateProjections(const glm::vec3 eyePos[2], float nearPlane, float farPlane) {
+	int count = getWallCount();
+
+	//Generalized perspective projection, P * M_T * T, for every wall and eye.
+	//Only the frustum extents depend on the eye, the wall basis is precomputed.
+	for (int eye = 0; eye < 2; eye++) {
+		glm::vec3 pe = eyePos[eye];
+
+		//T
+		glm::mat4 T = glm::mat4(1.0f);
+		T[3] = glm::vec4(-pe, 1.0f);
+
+		for (int wall = 0; wall < count; wall++) {
+			//Vector from eye to the lower-left corner, and eye to screen plane distance
+			glm::vec3 va = origins[wall] - pe;
+			float d = -glm::dot(normals[wall], va);
+			float scale = nearPlane / d;
+
+			//P (the other corners are the origin plus width/height along the basis)
+			float l = glm::dot(rights[wall], va) * scale;
+			float b = glm::dot(ups[wall], va) * scale;
+			float r = l + widths[wall] * scale;
+			float t = b + heights[wall] * scale;
+
+			glm::mat4 P = glm::frustum(l, r, b, t, nearPlane, farPlane);
+			projections[eye][wall] = P * bases[wall] * T;
+		}
+	}
+}
+
+glm::mat4 CaveGeometry::getWallFromNDC(int wall) {
+	//Maps a wall's off-axis NDC square onto the wall rectangle (depth is flattened away)
+	glm::vec3 halfRight = rights[wall] * (widths[wall] * 0.5f);
+	glm::vec3 halfUp = ups[wall] * (heights[wall] * 0.5f);
+
+	glm::mat4 m = glm::mat4(0.0f);
+	m[0] = glm::vec4(halfRight, 0.0f);
+	m[1] = glm::vec4(halfUp, 0.0f);
+	m[3] = glm::vec4(origins[wall] + halfRight + halfUp, 1.0f);
+	return m;
+}
+
+glm::mat3 CaveGeometry::getReprojection(int wall, glm::vec3 renderedEye, glm::vec3 eye, glm::vec3 planePoint) {
+	//Homography from wall uv seen by eye to wall uv of the image rendered from renderedEye,
+	//exact for content on the plane through planePoint parallel to the wall:
+	//uv -> wall point -> (ray from eye) reference plane -> (ray from renderedEye) wall point -> uv
+	glm::vec3 right = rights[wall] * widths[wall];
+	glm::vec3 up = ups[wall] * heights[wall];
+
+	glm::mat4 fromUV = glm::mat4(0.0f);
+	fromUV[0] = glm::vec4(right, 0.0f);
+	fromUV[1] = glm::vec4(up, 0.0f);
+	fromUV[3] = glm::vec4(origins[wall], 1.0f);
+
+	glm::vec3 r = right / glm::dot(right, right);
+	glm::vec3 u = up / glm::dot(up, up);
+	glm::mat4 toUV = glm::mat4(0.0f);
+	for (int i = 0; i < 3; i++) {
+		toUV[i][0] = r[i];
+		toUV[i][1] = u[i];
+	}
+	toUV[3][0] = -glm::dot(r, origins[wall]);
+	toUV[3][1] = -glm::dot(u, origins[wall]);
+	toUV[3][3] = 1.0f;
+
+	glm::mat4 h = toUV * projectOntoPlane(renderedEye, normals[wall], origins[wall]) * projectOntoPlane(eye, normals[wall], planePoint) * fromUV;
+
+	//Drop the (unused) depth row and column
+	const int index[3] = { 0, 1, 3 };
+	glm::mat3 warp = glm::mat3(1.0f);
+	for (int col = 0; col < 3; col++) {
+		for (int row = 0; row < 3; row++) warp[col][row] = h[index[col]][index[row]];
+	}
+	return warp;
+}
+
+glm::vec3 CaveGeometry::getCorner(int wall, int corner) {
+	glm::vec3 right = rights[wall] * widths[wall];
+	glm::vec3 up = ups[wall] * heights[wall];
+
+	switch (corner) {
+	case 1: return origins[wall] + right;
+	case 2: return origins[wall] + right + up;
+	case 3: return origins[wall] + up;
+	default: return origins[wall];
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+#ifndef CAVE_GEOMETRY_H
+#define CAVE_GEOMETRY_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+//Most walls a CAVE may have (must match MAX_WALLS in the layered shaders)
+#define MAX_WALLS 8
+
+//Wall rectangles of a CAVE, loaded from a config file. Per-wall data is kept in
+//contiguous arrays so every off-axis projection of both eyes is built in one pass.
+class CaveGeometry {
+public:
+	CaveGeometry(const char * path);
+	~CaveGeometry();
+
+	void updateProjections(const glm::vec3 eyePos[2], float nearPlane, float farPlane);
+
+	//Getters
+	int getWallCount() { return (int)origins.size(); }
+	const glm::mat4 & getProjection(int eye, int wall) { return projections[eye][wall]; }
+	const glm::mat4 * getProjections(int eye) { return &projections[eye][0]; }
+	glm::vec3 getNormal(int wall) { return normals[wall]; }
+	glm::vec3 getCorner(int wall, int corner);	//0 lower-left, 1 lower-right, 2 upper-right, 3 upper-left
+	glm::mat4 getWallFromNDC(int wall);
+	glm::mat3 getReprojection(int wall, glm::vec3 renderedEye, glm::vec3 eye, glm::vec3 planePoint);
+	float getWidth(int wall) { return widths[wall]; }
+	float getHeight(int wall) { return heights[wall]; }
+
+private:
+	//Per-wall data (lower-left corner, unit right/up/normal, size, world-to-wall rotation)
+	std::vector<glm::vec3> origins;
+	std::vector<glm::vec3> rights;
+	std::vector<glm::vec3> ups;
+	std::vector<glm::vec3> normals;
+	std::vector<float> widths;
+	std::vector<float> heights;
+	std::vector<glm::mat4> bases;
+
+	//Off-axis projections, [eye][wall]
+	std::vector<glm::mat4> projections[2];
+
+	void parse(const char * path);
+	void addWall(glm::vec3 pa, glm::vec3 pb, glm::vec3 pc);
+};
+
+#endif
@@ -0,0 +1,142 @@
+#include "DebugDraw.h"
+#include "Definitions.h"
+#include "GLState.h"
+#include "Profiler.h"
+#include "Shaders.h"
+
+#include <cstring>
+#include <iostream>
+
+StreamBuffer DebugDraw::stream(GL_ARRAY_BUFFER, DEBUG_DRAW_MAX_VERTICES * sizeof(glm::vec3));
+GLuint DebugDraw::VAO = 0;
+std::vector<DebugDraw::Batch> DebugDraw::batches;
+unsigned int DebugDraw::queued = 0;
+unsigned int DebugDraw::dropped = 0;
+
+//==============================================================================SETUP
+void DebugDraw::initGl() {
+	stream.initGl();
+
+	//Positions straight from the stream buffer; draws pick their range with the first vertex
+	glGenVertexArrays(1, &VAO);
+	glBindVertexArray(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, stream.getBuffer());
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (GLvoid*)0);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void DebugDraw::shutdownGl() {
+	glDeleteVertexArrays(1, &VAO);
+	VAO = 0;
+	stream.shutdownGl();
+	batches.clear();
+	queued = 0;
+}
+
+//==============================================================================QUEUE
+DebugDraw::Batch & DebugDraw::getBatch(glm::vec3 rgb) {
+	//A handful of colors per frame, a linear search is enough
+	for (Batch & b : batches) {
+		if (b.rgb == rgb) return b;
+	}
+	batches.emplace_back();
+	batches.back().rgb = rgb;
+	return batches.back();
+}
+
+void DebugDraw::line(glm::vec3 a, glm::vec3 b, glm::vec3 rgb) {
+	Batch & batch = getBatch(rgb);
+	batch.vertices.push_back(a);
+	batch.vertices.push_back(b);
+	queued += 2;
+}
+
+void DebugDraw::edges(const glm::vec3 corners[8], glm::vec3 rgb) {
+	//Each corner to the neighbours that differ in one axis, every edge once
+	for (int i = 0; i < 8; i++) {
+		for (int axis = 1; axis < 8; axis <<= 1) {
+			if (!(i & axis)) line(corners[i], corners[i | axis], rgb);
+		}
+	}
+}
+
+void DebugDraw::box(glm::vec3 min, glm::vec3 max, glm::vec3 rgb) {
+	glm::vec3 corners[8];
+	for (int i = 0; i < 8; i++) corners[i] = glm::vec3((i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y, (i & 4) ? max.z : min.z);
+	edges(corners, rgb);
+}
+
+void DebugDraw::frustum(const glm::mat4 & viewProjection, glm::vec3 rgb) {
+	//Corners of the NDC cube back in world space
+	glm::mat4 inverse = glm::inverse(viewProjection);
+	glm::vec3 corners[8];
+	for (int i = 0; i < 8; i++) {
+		glm::vec4 c = inverse * glm::vec4((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : -1.0f, 1.0f);
+		corners[i] = glm::vec3(c) / c.w;
+	}
+	edges(corners, rgb);
+}
+
+void DebugDraw::axes(const glm::mat4 & toWorld, float length) {
+	glm::vec3 origin = glm::vec3(toWorld[3]);
+	line(origin, origin + glm::vec3(toWorld[0]) * length, glm::vec3(COLOR_RED));
+	line(origin, origin + glm::vec3(toWorld[1]) * length, glm::vec3(COLOR_GREEN));
+	line(origin, origin + glm::vec3(toWorld[2]) * length, glm::vec3(COLOR_BLUE));
+}
+
+//==============================================================================FRAME
+void DebugDraw::upload() {
+	if (queued == 0) return;
+
+	//Each color's lines end up contiguous, so a color is one draw
+	stream.begin();
+	for (Batch & b : batches) {
+		if (b.vertices.empty()) continue;
+		GLsizeiptr size = b.vertices.size() * sizeof(glm::vec3);
+		GLintptr offset = 0;
+		void * data = stream.allocate(size, offset);
+		if (data == NULL) {
+			if (dropped == 0) std::cerr << "DebugDraw: more than " << DEBUG_DRAW_MAX_VERTICES << " vertices in a frame, dropping lines" << std::endl;
+			dropped += (unsigned int)b.vertices.size() / 2;
+			b.first = -1;
+			continue;
+		}
+		memcpy(data, &b.vertices[0], size);
+		b.first = (GLint)(offset / sizeof(glm::vec3));
+	}
+	stream.end();
+}
+
+void DebugDraw::draw(glm::mat4 view, glm::mat4 projection) {
+	if (queued == 0) return;
+
+	const ShaderProgram & shader = Shaders::getColorShader();
+	Shaders::setCamera(view, projection);
+	shader.use();
+	glm::mat4 m = glm::mat4(1.0f);
+	glUniformMatrix4fv(shader.get(UNIFORM_MODEL), 1, GL_FALSE, &m[0][0]);
+
+	GLState::bindVertexArray(VAO);
+	for (const Batch & b : batches) {
+		if (b.first < 0 || b.vertices.empty()) continue;
+		glUniform3f(shader.get(UNIFORM_RGB), b.rgb.x, b.rgb.y, b.rgb.z);
+		glDrawArrays(GL_LINES, b.first, (GLsizei)b.vertices.size());
+		Profiler::countDraw();
+	}
+}
+
+void DebugDraw::endFrame() {
+	if (queued == 0) return;
+
+	stream.fence();
+	Profiler::counter("debug draw stalls", stream.getStalls());
+
+	//Colors stay, so their vertex storage is reused next frame
+	for (Batch & b : batches) {
+		b.vertices.clear();
+		b.first = -1;
+	}
+	queued = 0;
+}
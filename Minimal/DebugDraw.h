@@ -0,0 +1,55 @@
+#pragma once
+#ifndef DEBUG_DRAW_H
+#define DEBUG_DRAW_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "StreamBuffer.h"
+
+#define DEBUG_DRAW_MAX_VERTICES 16384	//per frame, lines past this are dropped
+#define DEBUG_DRAW_AXIS_LENGTH 0.1f		//meters
+
+//Immediate mode debug lines. Anything may queue lines, boxes, frusta and axes during a
+//frame; upload() copies the frame's lines into a StreamBuffer once, draw() then costs one
+//draw call per color for each eye, and endFrame() fences the region and empties the queue.
+class DebugDraw {
+public:
+	static void initGl();
+	static void shutdownGl();
+
+	//Queue, in world space
+	static void line(glm::vec3 a, glm::vec3 b, glm::vec3 rgb);
+	static void box(glm::vec3 min, glm::vec3 max, glm::vec3 rgb);
+	static void frustum(const glm::mat4 & viewProjection, glm::vec3 rgb);	//edges of the clip volume
+	static void axes(const glm::mat4 & toWorld, float length = DEBUG_DRAW_AXIS_LENGTH);
+
+	static void upload();	//once per frame, after everything is queued
+	static void draw(glm::mat4 view, glm::mat4 projection);
+	static void endFrame();	//after the last draw of the frame
+
+	//Getters
+	static bool isEmpty() { return queued == 0; }
+	static unsigned int getDropped() { return dropped; }
+
+private:
+	//Lines of one color; first is the vertex index in the stream buffer once uploaded
+	struct Batch {
+		glm::vec3 rgb;
+		std::vector<glm::vec3> vertices;
+		GLint first = -1;
+	};
+
+	static StreamBuffer stream;
+	static GLuint VAO;
+	static std::vector<Batch> batches;	//kept across frames, emptied by endFrame()
+	static unsigned int queued;		//vertices this frame
+	static unsigned int dropped;
+
+	static Batch & getBatch(glm::vec3 rgb);
+	static void edges(const glm::vec3 corners[8], glm::vec3 rgb);	//the 12 edges of a box, corner bits are x, y, z
+};
+
+#endif
@@ -7,6 +7,7 @@
 //Shaders
 #define SHADER_COLOR_VERTEX "./shaders/color.vert"
 #define SHADER_COLOR_FRAGMENT "./shaders/color.frag"
+#define SHADER_INSTANCED_COLOR_VERTEX "./shaders/instancedColor.vert"
 #define SHADER_TEXTURE_VERTEX "./shaders/TextureShader.vert"
 #define SHADER_TEXTURE_FRAGMENT "./shaders/TextureShader.frag"
 #define SHADER_SKYBOX_VERTEX "./shaders/skybox.vert"
@@ -15,6 +16,10 @@
 #define SHADER_RENDERED_TEXTURE_FRAGMENT "./shaders/RenderedTextureShader.frag"
 #define SHADER_LCDISPLAY_VERTEX "./shaders/LCDisplayShader.vert"
 #define SHADER_LCDISPLAY_FRAGMENT "./shaders/LCDisplayShader.frag"
+#define SHADER_LAYERED_TEXTURE_VERTEX "./shaders/LayeredTextureShader.vert"
+#define SHADER_LAYERED_TEXTURE_GEOMETRY "./shaders/LayeredTextureShader.geom"
+#define SHADER_LAYERED_SKYBOX_VERTEX "./shaders/layeredSkybox.vert"
+#define SHADER_LAYERED_SKYBOX_GEOMETRY "./shaders/layeredSkybox.geom"
 
 //Textures
 #define TEXTURE_SKYBOX_LEFT "skybox/left"
@@ -27,6 +32,10 @@
 //Models
 #define MODEL_SPHERE "models/sphere.obj"
 
+//CAVE configs
+#define CAVE_CONFIG "caves/standard.cave"
+#define CAVE_CONFIG_FIVE_WALL "caves/fivewall.cave"
+
 //Colors
 #define COLOR_RED 1, 0, 0
 #define COLOR_GREEN 0, 1, 0
@@ -37,6 +46,12 @@
 #define COLOR_BLACK 0, 0, 0
 #define COLOR_WHITE .8f, .8f, .8f
 
+//Eyes and hands (same order as the Oculus SDK)
+#define EYE_LEFT 0
+#define EYE_RIGHT 1
+#define HAND_LEFT 0
+#define HAND_RIGHT 1
+
 //Variables
 #define MATH_PI 3.1415926535897932384626433832795f
 
@@ -0,0 +1,170 @@
+#include "GLState.h"
+#include "Profiler.h"
+
+GLuint GLState::program = GLSTATE_UNKNOWN;
+GLuint GLState::vao = GLSTATE_UNKNOWN;
+GLuint GLState::activeUnit = GLSTATE_UNKNOWN;
+GLuint GLState::textures[GLSTATE_TEXTURE_UNITS][TARGETS];
+GLuint GLState::drawFramebuffer = GLSTATE_UNKNOWN;
+GLuint GLState::readFramebuffer = GLSTATE_UNKNOWN;
+GLint GLState::viewportRect[4] = { 0, 0, 0, 0 };
+bool GLState::viewportKnown = false;
+GLuint GLState::enabled[CAPS];
+GLuint GLState::cullFaceMode = GLSTATE_UNKNOWN;
+GLuint GLState::depthFuncMode = GLSTATE_UNKNOWN;
+GLuint GLState::depthMaskValue = GLSTATE_UNKNOWN;
+GLuint GLState::colorMaskValue = GLSTATE_UNKNOWN;
+unsigned int GLState::issued = 0;
+unsigned int GLState::elided = 0;
+
+//The arrays start unknown like the values above, for state changed during init before the first reset()
+static struct GLStateInit { GLStateInit() { GLState::reset(); } } glStateInit;
+
+//==============================================================================FRAMES
+void GLState::reset() {
+	program = vao = activeUnit = GLSTATE_UNKNOWN;
+	for (int unit = 0; unit < GLSTATE_TEXTURE_UNITS; unit++) {
+		for (int target = 0; target < TARGETS; target++) textures[unit][target] = GLSTATE_UNKNOWN;
+	}
+	drawFramebuffer = readFramebuffer = GLSTATE_UNKNOWN;
+	viewportKnown = false;
+	for (int cap = 0; cap < CAPS; cap++) enabled[cap] = GLSTATE_UNKNOWN;
+	cullFaceMode = depthFuncMode = depthMaskValue = colorMaskValue = GLSTATE_UNKNOWN;
+}
+
+void GLState::endFrame() {
+	Profiler::counter("gl state issued", issued);
+	Profiler::counter("gl state elided", elided);
+	issued = elided = 0;
+}
+
+bool GLState::change(GLuint & shadow, GLuint value) {
+	if (shadow == value) {
+		elided++;
+		return false;
+	}
+	shadow = value;
+	issued++;
+	return true;
+}
+
+//==============================================================================BINDINGS
+void GLState::useProgram(GLuint p) {
+	if (change(program, p)) glUseProgram(p);
+}
+
+void GLState::bindVertexArray(GLuint v) {
+	if (change(vao, v)) glBindVertexArray(v);
+}
+
+void GLState::activeTexture(GLuint unit) {
+	if (change(activeUnit, unit)) glActiveTexture(GL_TEXTURE0 + unit);
+}
+
+void GLState::bindTexture(GLuint unit, GLenum target, GLuint texture) {
+	int t = targetIndex(target);
+	if (unit >= GLSTATE_TEXTURE_UNITS || t < 0) {
+		activeTexture(unit);
+		glBindTexture(target, texture);
+		issued++;
+		return;
+	}
+	//The unit is only switched when something is bound on it
+	if (textures[unit][t] == texture) {
+		elided++;
+		return;
+	}
+	activeTexture(unit);
+	change(textures[unit][t], texture);
+	glBindTexture(target, texture);
+}
+
+void GLState::bindFramebuffer(GLenum target, GLuint fbo) {
+	bool draw = target != GL_READ_FRAMEBUFFER;
+	bool read = target != GL_DRAW_FRAMEBUFFER;
+	if ((!draw || drawFramebuffer == fbo) && (!read || readFramebuffer == fbo)) {
+		elided++;
+		return;
+	}
+	if (draw) drawFramebuffer = fbo;
+	if (read) readFramebuffer = fbo;
+	glBindFramebuffer(target, fbo);
+	issued++;
+}
+
+void GLState::viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+	if (viewportKnown && viewportRect[0] == x && viewportRect[1] == y && viewportRect[2] == width && viewportRect[3] == height) {
+		elided++;
+		return;
+	}
+	viewportRect[0] = x;
+	viewportRect[1] = y;
+	viewportRect[2] = width;
+	viewportRect[3] = height;
+	viewportKnown = true;
+	glViewport(x, y, width, height);
+	issued++;
+}
+
+void GLState::forgetViewport() {
+	viewportKnown = false;
+}
+
+GLuint GLState::getDrawFramebuffer() {
+	if (drawFramebuffer == GLSTATE_UNKNOWN) {
+		GLint fbo = 0;
+		glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &fbo);
+		drawFramebuffer = (GLuint)fbo;
+	}
+	return drawFramebuffer;
+}
+
+//==============================================================================FIXED FUNCTION
+void GLState::setEnabled(GLenum cap, bool on) {
+	int c = capIndex(cap);
+	if (c < 0) {
+		if (on) glEnable(cap);
+		else glDisable(cap);
+		issued++;
+		return;
+	}
+	if (!change(enabled[c], on ? GL_TRUE : GL_FALSE)) return;
+	if (on) glEnable(cap);
+	else glDisable(cap);
+}
+
+void GLState::cullFace(GLenum face) {
+	if (change(cullFaceMode, face)) glCullFace(face);
+}
+
+void GLState::depthFunc(GLenum func) {
+	if (change(depthFuncMode, func)) glDepthFunc(func);
+}
+
+void GLState::depthMask(GLboolean mask) {
+	if (change(depthMaskValue, mask)) glDepthMask(mask);
+}
+
+void GLState::colorMask(GLboolean mask) {
+	if (change(colorMaskValue, mask)) glColorMask(mask, mask, mask, mask);
+}
+
+int GLState::capIndex(GLenum cap) {
+	switch (cap) {
+	case GL_CULL_FACE:		return CAP_CULL_FACE;
+	case GL_DEPTH_TEST:		return CAP_DEPTH_TEST;
+	case GL_STENCIL_TEST:	return CAP_STENCIL_TEST;
+	case GL_BLEND:			return CAP_BLEND;
+	case GL_SCISSOR_TEST:	return CAP_SCISSOR_TEST;
+	default:				return -1;
+	}
+}
+
+int GLState::targetIndex(GLenum target) {
+	switch (target) {
+	case GL_TEXTURE_2D:			return TARGET_2D;
+	case GL_TEXTURE_2D_ARRAY:	return TARGET_2D_ARRAY;
+	case GL_TEXTURE_CUBE_MAP:	return TARGET_CUBE_MAP;
+	default:					return -1;
+	}
+}
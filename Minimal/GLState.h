@@ -0,0 +1,70 @@
+#pragma once
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <GL/glew.h>
+
+#define GLSTATE_TEXTURE_UNITS 4		//units whose bindings are shadowed, others pass straight through
+#define GLSTATE_UNKNOWN 0xFFFFFFFFu	//shadow value that matches nothing, so the next call is issued
+
+//Shadow of the GL state the per-frame draw code changes: bound program, VAO, textures per
+//unit, framebuffers, viewport, depth and color masks, and a few enable bits. A call that
+//would not change anything is dropped instead of reaching the driver.
+//Only what goes through here is known. reset() forgets everything, and is called where
+//code outside this layer (the compositor, mirror blits, GL object setup) may have changed
+//state: at the start of every frame. Calls issued and elided are counted per frame.
+class GLState {
+public:
+	static void reset();
+	static void endFrame();		//per-frame counters to the profiler
+
+	static void useProgram(GLuint program);
+	static void bindVertexArray(GLuint vao);
+	static void bindTexture(GLuint unit, GLenum target, GLuint texture);	//unit as an index, 0 for GL_TEXTURE0
+	static void bindFramebuffer(GLenum target, GLuint fbo);
+	static void viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+	static void forgetViewport();	//after glViewportIndexed*, which also moves viewport 0
+
+	static void enable(GLenum cap) { setEnabled(cap, true); }
+	static void disable(GLenum cap) { setEnabled(cap, false); }
+	static void setEnabled(GLenum cap, bool on);
+	static void cullFace(GLenum face);
+	static void depthFunc(GLenum func);
+	static void depthMask(GLboolean mask);
+	static void colorMask(GLboolean mask);	//all four channels
+
+	//Getters
+	static GLuint getDrawFramebuffer();		//queries GL only while the shadow is unknown
+	static unsigned int getIssued() { return issued; }	//this frame
+	static unsigned int getElided() { return elided; }
+
+private:
+	//Enable bits that are shadowed, index into enabled[]
+	enum Cap { CAP_CULL_FACE, CAP_DEPTH_TEST, CAP_STENCIL_TEST, CAP_BLEND, CAP_SCISSOR_TEST, CAPS };
+	//Texture targets that are shadowed per unit
+	enum Target { TARGET_2D, TARGET_2D_ARRAY, TARGET_CUBE_MAP, TARGETS };
+
+	static GLuint program;
+	static GLuint vao;
+	static GLuint activeUnit;
+	static GLuint textures[GLSTATE_TEXTURE_UNITS][TARGETS];
+	static GLuint drawFramebuffer;
+	static GLuint readFramebuffer;
+	static GLint viewportRect[4];
+	static bool viewportKnown;
+	static GLuint enabled[CAPS];	//GL_TRUE, GL_FALSE or GLSTATE_UNKNOWN
+	static GLuint cullFaceMode;
+	static GLuint depthFuncMode;
+	static GLuint depthMaskValue;
+	static GLuint colorMaskValue;
+
+	static unsigned int issued;
+	static unsigned int elided;
+
+	static int capIndex(GLenum cap);
+	static int targetIndex(GLenum target);
+	static void activeTexture(GLuint unit);
+	static bool change(GLuint & shadow, GLuint value);	//true (and counted as issued) when the call must be made
+};
+
+#endif
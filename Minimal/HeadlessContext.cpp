@@ -0,0 +1,92 @@
+#include "HeadlessContext.h"
+
+#include <iostream>
+
+#ifdef __linux__
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+HeadlessContext::HeadlessContext() { }
+
+HeadlessContext::~HeadlessContext() {
+	destroy();
+}
+
+#ifdef __linux__
+
+bool HeadlessContext::create() {
+	//Prefer the surfaceless platform (no X or Wayland needed), fall back to the default display
+	EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (getPlatformDisplay) eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+	if (eglDisplay == EGL_NO_DISPLAY) eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+	EGLint major, minor;
+	if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, &major, &minor)) {
+		std::cerr << "Unable to initialize EGL" << std::endl;
+		return false;
+	}
+
+	const EGLint configAttributes[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_NONE
+	};
+	EGLConfig config;
+	EGLint configCount = 0;
+	if (!eglChooseConfig(eglDisplay, configAttributes, &config, 1, &configCount) || configCount == 0) {
+		std::cerr << "No EGL config supports desktop OpenGL" << std::endl;
+		eglTerminate(eglDisplay);
+		return false;
+	}
+
+	//Same context the window path asks GLFW for
+	eglBindAPI(EGL_OPENGL_API);
+	const EGLint contextAttributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 4,
+		EGL_CONTEXT_MINOR_VERSION, 1,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	EGLContext eglContext = eglCreateContext(eglDisplay, config, EGL_NO_CONTEXT, contextAttributes);
+	if (eglContext == EGL_NO_CONTEXT) {
+		std::cerr << "Unable to create an OpenGL 4.1 core EGL context" << std::endl;
+		eglTerminate(eglDisplay);
+		return false;
+	}
+
+	//Everything renders into FBOs, so no surface is bound
+	if (!eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, eglContext)) {
+		std::cerr << "Unable to make the EGL context current (EGL_KHR_surfaceless_context missing?)" << std::endl;
+		eglDestroyContext(eglDisplay, eglContext);
+		eglTerminate(eglDisplay);
+		return false;
+	}
+
+	display = eglDisplay;
+	context = eglContext;
+	std::cout << "Headless EGL " << major << "." << minor << " context created" << std::endl;
+	return true;
+}
+
+void HeadlessContext::destroy() {
+	if (!display) return;
+
+	eglMakeCurrent((EGLDisplay)display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	if (context) eglDestroyContext((EGLDisplay)display, (EGLContext)context);
+	eglTerminate((EGLDisplay)display);
+	display = nullptr;
+	context = nullptr;
+}
+
+#else
+
+bool HeadlessContext::create() {
+	std::cerr << "Headless contexts need EGL, which is only supported on Linux" << std::endl;
+	return false;
+}
+
+void HeadlessContext::destroy() { }
+
+#endif
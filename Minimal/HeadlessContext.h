@@ -0,0 +1,21 @@
+#pragma once
+#ifndef HEADLESS_CONTEXT_H
+#define HEADLESS_CONTEXT_H
+
+//Windowless OpenGL 4.1 core context for benchmark machines without a display. Uses a
+//surfaceless EGL context (Mesa's surfaceless platform also covers software rendering),
+//so it is only available on Linux; create() fails elsewhere.
+class HeadlessContext {
+public:
+	HeadlessContext();
+	~HeadlessContext();
+
+	bool create();
+	void destroy();
+
+private:
+	void * display = nullptr;
+	void * context = nullptr;
+};
+
+#endif
@@ -0,0 +1,72 @@
+#pragma once
+#ifndef HMD_BACKEND_H
+#define HMD_BACKEND_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+
+#include "Input.h"
+
+//Tracking and controller state of one frame. Poses are world-from-local (a view matrix is the inverse).
+struct HmdFrame {
+	glm::mat4 eyePoses[2] = { glm::mat4(1.0f), glm::mat4(1.0f) };
+	glm::mat4 handPoses[2] = { glm::mat4(1.0f), glm::mat4(1.0f) };
+	bool inputValid = false;
+	InputState input;
+};
+
+//Display a RiftApp renders to: where poses and input come from, which texture the eye
+//buffer renders into and where finished frames go.
+class HmdBackend {
+public:
+	virtual ~HmdBackend() { }
+
+	virtual void initGl() = 0;
+	virtual void shutdownGl() = 0;
+
+	virtual HmdFrame beginFrame(unsigned int frame) = 0;	//samples poses and input for this frame
+	//Samples the poses again right before they are used: both hands and the given eye (both when eye < 0).
+	//The frame is submitted with the latched eye poses. Backends with nothing newer leave the poses as they are.
+	virtual void latchPoses(unsigned int frame, HmdFrame & poses, int eye = -1) { }
+	//Polls the controllers alone, from any thread (the input sampler's). Backends whose input only
+	//comes with beginFrame() return false, their frames' input is handed over by the render loop.
+	virtual bool sampleInput(InputState & state) { return false; }
+	virtual GLuint getEyeTexture() = 0;					//color texture to render both eyes into this frame
+	virtual void submitFrame(unsigned int frame) = 0;
+	virtual void blitMirror(glm::uvec2 windowSize) = 0;	//copies the last frame to the bound window
+	virtual void recenter() { }
+	virtual double getTime() = 0;						//seconds, on the backend's clock
+	virtual bool isFinished() { return false; }			//no more frames to show (the app exits)
+
+	//Renders the eyes at a pixel density below the one the target was allocated for (1 is the display's
+	//native density): the viewports shrink from their bottom left corner and the compositor upsamples
+	virtual void setPixelDensity(float density) {
+		pixelDensity = glm::clamp(density, 0.0f, maxPixelDensity);
+		float scale = pixelDensity / maxPixelDensity;
+		for (int eye = 0; eye < 2; eye++) {
+			glm::ivec4 full = fullViewports[eye];
+			viewports[eye] = glm::ivec4(full.x, full.y, std::max((int)(full.z * scale), 1), std::max((int)(full.w * scale), 1));
+		}
+	}
+
+	//Getters
+	glm::uvec2 getRenderTargetSize() { return renderTargetSize; }
+	glm::uvec2 getMirrorSize() { return mirrorSize; }
+	glm::ivec4 getViewport(int eye) { return viewports[eye]; }	//x, y, width, height in the render target
+	float getPixelDensity() { return pixelDensity; }
+	float getMaxPixelDensity() { return maxPixelDensity; }
+	glm::mat4 getProjection(int eye) { return projections[eye]; }
+
+protected:
+	glm::uvec2 renderTargetSize = glm::uvec2(0);
+	glm::uvec2 mirrorSize = glm::uvec2(0);
+	glm::ivec4 viewports[2];
+	glm::ivec4 fullViewports[2];	//at maxPixelDensity, what the render target was allocated for
+	float maxPixelDensity = 1.0f;
+	float pixelDensity = 1.0f;
+	glm::mat4 projections[2];
+};
+
+#endif
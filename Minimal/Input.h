@@ -2,56 +2,100 @@
 #ifndef INPUT_H
 #define INPUT_H
 
-#define INPUT_STICK_SMOOTHING 0.01f
-
 #include <glm/glm.hpp>
 
+//Buttons and triggers, as indices into InputState::buttons and the event controls
+enum InputButton {
+	INPUT_INDEX_TRIGGER_L,
+	INPUT_INDEX_TRIGGER_R,
+	INPUT_HAND_TRIGGER_L,
+	INPUT_HAND_TRIGGER_R,
+	INPUT_BUTTON_A,
+	INPUT_BUTTON_B,
+	INPUT_BUTTON_X,
+	INPUT_BUTTON_Y,
+	INPUT_BUTTON_STICK_L,
+	INPUT_BUTTON_STICK_R,
+	INPUT_BUTTONS
+};
+
+enum InputStick {
+	INPUT_STICK_L,
+	INPUT_STICK_R
+};
+
+//Raw controller state of one sample, as reported by a display backend
+struct InputState {
+	bool indexTriggerL = false;
+	bool indexTriggerR = false;
+	bool handTriggerL = false;
+	bool handTriggerR = false;
+	bool buttonA = false;
+	bool buttonB = false;
+	bool buttonX = false;
+	bool buttonY = false;
+	glm::vec2 stickL = glm::vec2(0.0f);
+	glm::vec2 stickR = glm::vec2(0.0f);
+	bool buttonStickL = false;
+	bool buttonStickR = false;
+
+	bool getButton(int button) const {
+		switch (button) {
+		case INPUT_INDEX_TRIGGER_L: return indexTriggerL;
+		case INPUT_INDEX_TRIGGER_R: return indexTriggerR;
+		case INPUT_HAND_TRIGGER_L: return handTriggerL;
+		case INPUT_HAND_TRIGGER_R: return handTriggerR;
+		case INPUT_BUTTON_A: return buttonA;
+		case INPUT_BUTTON_B: return buttonB;
+		case INPUT_BUTTON_X: return buttonX;
+		case INPUT_BUTTON_Y: return buttonY;
+		case INPUT_BUTTON_STICK_L: return buttonStickL;
+		case INPUT_BUTTON_STICK_R: return buttonStickR;
+		default: return false;
+		}
+	}
+	glm::vec2 getStick(int stick) const { return stick == INPUT_STICK_L ? stickL : stickR; }
+};
+
+enum InputEventType {
+	INPUT_PRESS,
+	INPUT_RELEASE,
+	INPUT_STICK_MOVE
+};
+
+//One change of the controllers, at the time it was sampled
+struct InputEvent {
+	double time = 0.0;				//seconds, on the backend's clock
+	InputEventType type = INPUT_PRESS;
+	int control = 0;				//InputButton, or InputStick for stick moves
+	glm::vec2 value = glm::vec2(0.0f);	//stick position (-1 to 1)
+	glm::vec2 delta = glm::vec2(0.0f);	//stick change since its last event
+};
+
+//Controller state as of the last applied event. Only touched by the thread that drains the events.
 class Input {
 public:
-	//Setters
-	static void setIndexTriggerL(bool b) { indexTriggerL = b; }
-	static void setIndexTriggerR(bool b) { indexTriggerR = b; }
-	static void setHandTriggerL(bool b) { handTriggerL = b; }
-	static void setHandTriggerR(bool b) { handTriggerR = b; }
-	static void setButtonA(bool b) { buttonA = b; }
-	static void setButtonB(bool b) { buttonB = b; }
-	static void setButtonX(bool b) { buttonX = b; }
-	static void setButtonY(bool b) { buttonY = b; }
-	static void setStickL(glm::vec2 v) { stickL.x = v.x * INPUT_STICK_SMOOTHING; stickL.y = v.y * INPUT_STICK_SMOOTHING; }
-	static void setStickR(glm::vec2 v) { stickR.x = v.x * INPUT_STICK_SMOOTHING; stickR.y = v.y * INPUT_STICK_SMOOTHING; }
-	static void setButtonStickL(bool b) { buttonStickL = b; }
-	static void setButtonStickR(bool b) { buttonStickR = b; }
+	static void apply(const InputEvent & e) {
+		if (e.type == INPUT_STICK_MOVE) sticks[e.control] = e.value;
+		else buttons[e.control] = (e.type == INPUT_PRESS);
+	}
 	//Getters
-	static bool getIndexTriggerL() { return indexTriggerL; }
-	static bool getIndexTriggerR() { return indexTriggerR; }
-	static bool getHandTriggerL() { return handTriggerL; }
-	static bool getHandTriggerR() { return handTriggerR; }
-	static bool getButtonA() { return buttonA; }
-	static bool getButtonB() { return buttonB; }
-	static bool getButtonX() { return buttonX; }
-	static bool getButtonY() { return buttonY; }
-	static glm::vec2 getStickL() { return stickL; }
-	static glm::vec2 getStickR() { return stickR; }
-	static bool getButtonStickL() { return buttonStickL; }
-	static bool getButtonStickR() { return buttonStickR; }
+	static bool getIndexTriggerL() { return buttons[INPUT_INDEX_TRIGGER_L]; }
+	static bool getIndexTriggerR() { return buttons[INPUT_INDEX_TRIGGER_R]; }
+	static bool getHandTriggerL() { return buttons[INPUT_HAND_TRIGGER_L]; }
+	static bool getHandTriggerR() { return buttons[INPUT_HAND_TRIGGER_R]; }
+	static bool getButtonA() { return buttons[INPUT_BUTTON_A]; }
+	static bool getButtonB() { return buttons[INPUT_BUTTON_B]; }
+	static bool getButtonX() { return buttons[INPUT_BUTTON_X]; }
+	static bool getButtonY() { return buttons[INPUT_BUTTON_Y]; }
+	static glm::vec2 getStickL() { return sticks[INPUT_STICK_L]; }	//-1 to 1, scaled to speeds by the simulation step
+	static glm::vec2 getStickR() { return sticks[INPUT_STICK_R]; }
+	static bool getButtonStickL() { return buttons[INPUT_BUTTON_STICK_L]; }
+	static bool getButtonStickR() { return buttons[INPUT_BUTTON_STICK_R]; }
 
 protected:
-	//Index Trigger
-	static bool indexTriggerL;
-	static bool indexTriggerR;
-	//Hand Trigger
-	static bool handTriggerL;
-	static bool handTriggerR;
-	//Buttons
-	static bool buttonA;
-	static bool buttonB;
-	static bool buttonX;
-	static bool buttonY;
-	//Sticks
-	static glm::vec2 stickL;
-	static glm::vec2 stickR;
-	static bool buttonStickL;
-	static bool buttonStickR;
+	static bool buttons[INPUT_BUTTONS];
+	static glm::vec2 sticks[2];
 };
 
-#endif
\ No newline at end of file
+#endif
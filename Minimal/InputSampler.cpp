@@ -0,0 +1,89 @@
+#include "InputSampler.h"
+#include "HmdBackend.h"
+
+#include <chrono>
+#include <iostream>
+
+InputSampler::InputSampler(HmdBackend * backend) : backend(backend) { }
+
+InputSampler::~InputSampler() {
+	stop();
+	if (dropped.load() > 0) std::cerr << "Input: " << dropped.load() << " events dropped (ring full)" << std::endl;
+}
+
+bool InputSampler::start() {
+	InputState probe;
+	if (!backend->sampleInput(probe)) return false;
+	if (running.exchange(true)) return true;
+	thread = std::thread(&InputSampler::run, this);
+	return true;
+}
+
+void InputSampler::stop() {
+	if (!running.exchange(false)) return;
+	thread.join();
+}
+
+//==============================================================================SAMPLER THREAD
+void InputSampler::run() {
+	using namespace std::chrono;
+	const auto period = duration_cast<steady_clock::duration>(duration<double>(1.0 / INPUT_SAMPLE_RATE));
+
+	auto next = steady_clock::now();
+	while (running.load()) {
+		InputState state;
+		if (backend->sampleInput(state)) sample(state, backend->getTime());
+
+		//Fixed rate; after a stall it carries on from now rather than polling back to back
+		next += period;
+		auto now = steady_clock::now();
+		if (next < now) next = now;
+		std::this_thread::sleep_until(next);
+	}
+}
+
+//==============================================================================PRODUCER
+void InputSampler::sample(const InputState & state, double time) {
+	InputEvent e;
+	e.time = time;
+
+	for (int button = 0; button < INPUT_BUTTONS; button++) {
+		bool down = state.getButton(button);
+		if (down == last.getButton(button)) continue;
+		e.type = down ? INPUT_PRESS : INPUT_RELEASE;
+		e.control = button;
+		push(e);
+	}
+
+	last = state;
+
+	//Compared with the last reported position, so slow drifts still add up to an event
+	for (int stick = INPUT_STICK_L; stick <= INPUT_STICK_R; stick++) {
+		glm::vec2 value = state.getStick(stick);
+		glm::vec2 delta = value - reported[stick];
+		//Letting go always reaches zero, however small the last step
+		bool released = (value == glm::vec2(0.0f)) && (delta != glm::vec2(0.0f));
+		if (glm::length(delta) < INPUT_STICK_THRESHOLD && !released) continue;
+		e.type = INPUT_STICK_MOVE;
+		e.control = stick;
+		e.value = value;
+		e.delta = delta;
+		push(e);
+		reported[stick] = value;
+	}
+}
+
+void InputSampler::push(const InputEvent & event) {
+	if (!events.push(event)) dropped++;
+}
+
+//==============================================================================CONSUMER
+bool InputSampler::poll(InputEvent & event) {
+	return events.pop(event);
+}
+
+bool InputSampler::poll(InputEvent & event, double until) {
+	if (!events.peek(event) || event.time > until) return false;
+	events.pop();
+	return true;
+}
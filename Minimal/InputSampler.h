@@ -0,0 +1,55 @@
+#pragma once
+#ifndef INPUT_SAMPLER_H
+#define INPUT_SAMPLER_H
+
+#include <atomic>
+#include <thread>
+
+#include "Input.h"
+#include "SpscRing.h"
+
+class HmdBackend;
+
+#define INPUT_SAMPLE_RATE 1000.0		//controller polls per second on the sampler thread
+#define INPUT_RING_SIZE 1024			//events in flight, a second of presses at any sensible rate
+#define INPUT_STICK_THRESHOLD 0.01f		//smaller stick changes are not an event
+
+//Turns controller state into timestamped press, release and stick events. Backends that can be
+//polled off the render thread are sampled by a thread of its own at INPUT_SAMPLE_RATE, so presses
+//shorter than a frame are not lost and events carry the time they happened; for the others the
+//render loop hands over each frame's state instead. Either way there is a single producer, and
+//the events reach a single consumer (the simulation) through a lock-free ring.
+class InputSampler {
+public:
+	InputSampler(HmdBackend * backend);
+	~InputSampler();
+
+	bool start();		//false if the backend cannot be polled from another thread
+	void stop();
+	bool isRunning() { return running.load(); }
+
+	//Producer: the sampler thread, or the render loop while it is not running
+	void sample(const InputState & state, double time);
+
+	//Consumer: the oldest event, optionally only if it happened by the given time
+	bool poll(InputEvent & event);
+	bool poll(InputEvent & event, double until);
+
+	//Getters
+	unsigned int getDropped() { return dropped.load(); }	//events lost to a full ring
+
+private:
+	HmdBackend * backend;
+	InputState last;		//producer only
+	glm::vec2 reported[2] = { glm::vec2(0.0f), glm::vec2(0.0f) };	//stick positions of the last events
+	SpscRing<InputEvent, INPUT_RING_SIZE> events;
+	std::atomic<unsigned int> dropped{ 0 };
+
+	std::thread thread;
+	std::atomic<bool> running{ false };
+
+	void run();
+	void push(const InputEvent & event);
+};
+
+#endif
@@ -26,18 +26,16 @@ Model::~Model(){
 	glDeleteBuffers(1, &EBO);
 }
 
-void Model::draw(glm::mat4 projection, glm::mat4 headPose, GLint shader, glm::vec3 rgb, glm::mat4 M) {
-	glUseProgram(shader);
-	glUniformMatrix4fv(glGetUniformLocation(shader, "projection"), 1, GL_FALSE, &projection[0][0]);
-	glUniformMatrix4fv(glGetUniformLocation(shader, "view"), 1, GL_FALSE, &headPose[0][0]);
-	glUniformMatrix4fv(glGetUniformLocation(shader, "model"), 1, GL_FALSE, &M[0][0]);
-
-	glUniform3f(glGetUniformLocation(shader, "rgb"), rgb.x, rgb.y, rgb.z);
-
-	glBindVertexArray(VAO);
-	glDrawElements(GL_TRIANGLES, (GLsizei)indices.size(), GL_UNSIGNED_INT, 0);
-
-	glBindVertexArray(0);
+void Model::submit(const ShaderProgram & shader, glm::vec3 rgb, glm::mat4 M) {
+	RenderPacket packet;
+	packet.shader = &shader;
+	packet.vao = VAO;
+	packet.count = (GLsizei)indices.size();
+	packet.model = M;
+	packet.center = glm::vec3(M[3]);
+	packet.rgb = rgb;
+	packet.instanced = true;
+	RenderQueue::submit(RENDER_PASS_OPAQUE, packet);
 }
 
 void Model::parse(const char * filepath) {
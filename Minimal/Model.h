@@ -10,13 +10,17 @@
 #include <string>
 #include <vector>
 
+#include "RenderQueue.h"
+
 class Model{
 public:
 	Model(const char * path);
 	Model(const Model& model);
 	~Model();
 
-	void draw(glm::mat4 projection, glm::mat4 headPose, GLint shader, glm::vec3 rgb, glm::mat4 M);
+	//To the RenderQueue as an instance: every submit of this model with the same shader in a view is
+	//one instanced draw, so shader has to take model and rgb as instance attributes (Shaders::getInstancedColorShader)
+	void submit(const ShaderProgram & shader, glm::vec3 rgb, glm::mat4 M);
 
 private:
 	std::vector<GLuint> indices;
@@ -1,17 +1,24 @@
 #include "ObjectManager.h"
 #include "Definitions.h"
 #include "Shaders.h"
-#include "Shader.h"
+#include "shader.h"
 #include "Transform.h"
 #include "TexturedCube.h"
 #include "Skybox.h"
 
+#define HAND_SCALE 0.015f	//sphere model to hand size
+
 //Init Shaders
-GLint Shaders::colorShader = 0;
-GLint Shaders::textureShader = 0;
-GLint Shaders::skyboxShader = 0;
-GLint Shaders::renderedTextureShader = 0;
-GLint Shaders::LCDisplayShader = 0;
+ShaderProgram Shaders::colorShader;
+ShaderProgram Shaders::instancedColorShader;
+ShaderProgram Shaders::textureShader;
+ShaderProgram Shaders::skyboxShader;
+ShaderProgram Shaders::renderedTextureShader;
+ShaderProgram Shaders::LCDisplayShader;
+ShaderProgram Shaders::layeredTextureShader;
+ShaderProgram Shaders::layeredSkyboxShader;
+GLuint Shaders::cameraBuffer = 0;
+Shaders::CameraBlock Shaders::camera;
 //Declare Models
 Model * sphere;
 //Declare Objects
@@ -21,10 +28,11 @@ Transform * handR;
 Skybox * skyboxCustom;
 
 ObjectManager::~ObjectManager() {
-	//Delete objects (also deletes models)
+	//Delete objects, then the models they share
 	delete(handL);
 	delete(handR);
 	delete(skyboxCustom);
+	delete(sphere);
 	//Delete shaders
 	Shaders::deleteShaders();
 }
@@ -39,10 +47,14 @@ ObjectManager::ObjectManager() {
 void ObjectManager::initShaders() {
 
 	Shaders::setColorShader(LoadShaders(SHADER_COLOR_VERTEX, SHADER_COLOR_FRAGMENT));
+	Shaders::setInstancedColorShader(LoadShaders(SHADER_INSTANCED_COLOR_VERTEX, SHADER_COLOR_FRAGMENT));
 	Shaders::setTextureShader(LoadShaders(SHADER_TEXTURE_VERTEX, SHADER_TEXTURE_FRAGMENT));
 	Shaders::setSkyboxShader(LoadShaders(SHADER_SKYBOX_VERTEX, SHADER_SKYBOX_FRAGMENT));
 	Shaders::setRenderedTextureShader(LoadShaders(SHADER_RENDERED_TEXTURE_VERTEX, SHADER_RENDERED_TEXTURE_FRAGMENT));
 	Shaders::setLCDisplayShader(LoadShaders(SHADER_LCDISPLAY_VERTEX, SHADER_LCDISPLAY_FRAGMENT));
+	Shaders::setLayeredTextureShader(LoadShaders(SHADER_LAYERED_TEXTURE_VERTEX, SHADER_LAYERED_TEXTURE_GEOMETRY, SHADER_TEXTURE_FRAGMENT));
+	Shaders::setLayeredSkyboxShader(LoadShaders(SHADER_LAYERED_SKYBOX_VERTEX, SHADER_LAYERED_SKYBOX_GEOMETRY, SHADER_SKYBOX_FRAGMENT));
+	Shaders::initCamera();
 }
 
 void ObjectManager::initModels() {
@@ -51,30 +63,23 @@ void ObjectManager::initModels() {
 
 void ObjectManager::initObjects() {
 	skyboxCustom = new Skybox(TEXTURE_SKYBOX_CUSTOM);
-	handL = new Transform(sphere, Shaders::getColorShader(), glm::vec3(COLOR_CYAN));
-	handR = new Transform(sphere, Shaders::getColorShader(), glm::vec3(COLOR_RED));
+	handL = new Transform(sphere, &Shaders::getInstancedColorShader(), glm::vec3(COLOR_CYAN));
+	handR = new Transform(sphere, &Shaders::getInstancedColorShader(), glm::vec3(COLOR_RED));
 }
 
 void ObjectManager::initValues() {
 
 }
 
-void ObjectManager::draw(glm::mat4 headPose, glm::mat4 projection, int eye) {
-	//Draw skybox skybox
-	skyboxCustom->draw(projection, headPose, Shaders::getSkyboxShader());
-	//Draw hands
-	handL->draw(headPose, projection);
-	handR->draw(headPose, projection);
+void ObjectManager::submit(int eye, const glm::mat4 handPoses[2]) {
+	//Skybox (the queue draws it after the hands and the cave walls)
+	skyboxCustom->submit(Shaders::getSkyboxShader());
+	//Hands, one instanced draw. Placed per draw rather than through their transforms, which the simulation thread updates
+	handL->submit(glm::scale(handPoses[HAND_LEFT], glm::vec3(HAND_SCALE)));
+	handR->submit(glm::scale(handPoses[HAND_RIGHT], glm::vec3(HAND_SCALE)));
 }
 
 void ObjectManager::update(double deltaTime) {
 	handL->update(deltaTime);
 	handR->update(deltaTime);
-}
-
-void ObjectManager::updateHands(glm::mat4 left, glm::mat4 right) {
-	handL->setToWorld(left);
-	handL->scale(0.015f);
-	handR->setToWorld(right);
-	handR->scale(0.015f);
 }
\ No newline at end of file
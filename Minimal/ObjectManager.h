@@ -4,14 +4,18 @@
 
 #include <glm/glm.hpp>
 
+#include "SceneState.h"
+
 class ObjectManager {
 public:
 	ObjectManager();
 	~ObjectManager();
 
-	void draw(glm::mat4 headPose, glm::mat4 projection, int eye);
+	//Render thread: skybox, and hands at the latched tracking poses, to the eye's queue (RenderQueue::begin() with the eye camera)
+	void submit(int eye, const glm::mat4 handPoses[2]);
+
+	//Simulation thread
 	void update(double deltaTime);
-	void updateHands(glm::mat4 handL, glm::mat4 handR);
 
 private:
 	void initShaders();
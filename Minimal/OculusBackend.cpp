@@ -0,0 +1,265 @@
+#include "OculusBackend.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtx/quaternion.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#define FAIL(X) throw std::runtime_error(X)
+
+namespace ovr
+{
+	// Convenience method for looping over each eye with a lambda
+	template <typename Function>
+	inline void for_each_eye(Function function)
+	{
+		for (ovrEyeType eye = ovrEyeType::ovrEye_Left;
+			eye < ovrEyeType::ovrEye_Count;
+			eye = static_cast<ovrEyeType>(eye + 1))
+		{
+			function(eye);
+		}
+	}
+
+	inline glm::mat4 toGlm(const ovrMatrix4f& om)
+	{
+		return glm::transpose(glm::make_mat4(&om.M[0][0]));
+	}
+
+	inline glm::vec3 toGlm(const ovrVector3f& ov)
+	{
+		return glm::make_vec3(&ov.x);
+	}
+
+	inline glm::vec2 toGlm(const ovrVector2f& ov)
+	{
+		return glm::make_vec2(&ov.x);
+	}
+
+	inline glm::quat toGlm(const ovrQuatf& oq)
+	{
+		return glm::make_quat(&oq.x);
+	}
+
+	inline glm::mat4 toGlm(const ovrPosef& op)
+	{
+		glm::mat4 orientation = glm::mat4_cast(toGlm(op.Orientation));
+		glm::mat4 translation = glm::translate(glm::mat4(), ovr::toGlm(op.Position));
+		return translation * orientation;
+	}
+}
+
+OculusBackend::OculusBackend(float maxDensity) {
+	maxPixelDensity = pixelDensity = maxDensity;
+	if (!OVR_SUCCESS(ovr_Initialize(nullptr)))
+	{
+		FAIL("Failed to initialize the Oculus SDK");
+	}
+	if (!OVR_SUCCESS(ovr_Create(&_session, &_luid)))
+	{
+		FAIL("Unable to create HMD session");
+	}
+	_hmdDesc = ovr_GetHmdDesc(_session);
+
+	_viewScaleDesc.HmdSpaceToWorldScaleInMeters = 1.0f;
+
+	memset(&_sceneLayer, 0, sizeof(ovrLayerEyeFov));
+	_sceneLayer.Header.Type = ovrLayerType_EyeFov;
+	_sceneLayer.Header.Flags = ovrLayerFlag_TextureOriginAtBottomLeft;
+
+	ovr::for_each_eye([&](ovrEyeType eye)
+	{
+		ovrEyeRenderDesc& erd = _eyeRenderDescs[eye] = ovr_GetRenderDesc(_session, eye, _hmdDesc.DefaultEyeFov[eye]);
+		ovrMatrix4f ovrPerspectiveProjection =
+			ovrMatrix4f_Projection(erd.Fov, 0.01f, 1000.0f, ovrProjection_ClipRangeOpenGL);
+		projections[eye] = ovr::toGlm(ovrPerspectiveProjection);
+		_viewScaleDesc.HmdToEyePose[eye] = erd.HmdToEyePose;
+
+		ovrFovPort& fov = _sceneLayer.Fov[eye] = _eyeRenderDescs[eye].Fov;
+		auto eyeSize = ovr_GetFovTextureSize(_session, eye, fov, maxPixelDensity);
+		_sceneLayer.Viewport[eye].Size = eyeSize;
+		_sceneLayer.Viewport[eye].Pos = { (int)renderTargetSize.x, 0 };
+		viewports[eye] = fullViewports[eye] = glm::ivec4((int)renderTargetSize.x, 0, eyeSize.w, eyeSize.h);
+
+		renderTargetSize.y = std::max(renderTargetSize.y, (uint32_t)eyeSize.h);
+		renderTargetSize.x += eyeSize.w;
+	});
+	// Make the on screen window 1/4 the native resolution of the render target
+	mirrorSize = glm::uvec2((unsigned int)(renderTargetSize.x / maxPixelDensity), (unsigned int)(renderTargetSize.y / maxPixelDensity));
+	mirrorSize /= 4;
+}
+
+OculusBackend::~OculusBackend() {
+	ovr_Destroy(_session);
+	_session = nullptr;
+	ovr_Shutdown();
+}
+
+void OculusBackend::initGl() {
+	ovrTextureSwapChainDesc desc = {};
+	desc.Type = ovrTexture_2D;
+	desc.ArraySize = 1;
+	desc.Width = renderTargetSize.x;
+	desc.Height = renderTargetSize.y;
+	desc.MipLevels = 1;
+	desc.Format = OVR_FORMAT_R8G8B8A8_UNORM_SRGB;
+	desc.SampleCount = 1;
+	desc.StaticImage = ovrFalse;
+	ovrResult result = ovr_CreateTextureSwapChainGL(_session, &desc, &_eyeTexture);
+	_sceneLayer.ColorTexture[0] = _eyeTexture;
+	if (!OVR_SUCCESS(result))
+	{
+		FAIL("Failed to create swap textures");
+	}
+
+	int length = 0;
+	result = ovr_GetTextureSwapChainLength(_session, _eyeTexture, &length);
+	if (!OVR_SUCCESS(result) || !length)
+	{
+		FAIL("Unable to count swap chain textures");
+	}
+	for (int i = 0; i < length; ++i)
+	{
+		GLuint chainTexId;
+		ovr_GetTextureSwapChainBufferGL(_session, _eyeTexture, i, &chainTexId);
+		glBindTexture(GL_TEXTURE_2D, chainTexId);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	ovrMirrorTextureDesc mirrorDesc;
+	memset(&mirrorDesc, 0, sizeof(mirrorDesc));
+	mirrorDesc.Format = OVR_FORMAT_R8G8B8A8_UNORM_SRGB;
+	mirrorDesc.Width = mirrorSize.x;
+	mirrorDesc.Height = mirrorSize.y;
+	if (!OVR_SUCCESS(ovr_CreateMirrorTextureGL(_session, &mirrorDesc, &_mirrorTexture)))
+	{
+		FAIL("Could not create mirror texture");
+	}
+	glGenFramebuffers(1, &_mirrorFbo);
+}
+
+void OculusBackend::shutdownGl() {
+	glDeleteFramebuffers(1, &_mirrorFbo);
+	ovr_DestroyMirrorTexture(_session, _mirrorTexture);
+	ovr_DestroyTextureSwapChain(_session, _eyeTexture);
+}
+
+HmdFrame OculusBackend::beginFrame(unsigned int frame) {
+	HmdFrame result;
+
+	//Eye poses (also handed back to the compositor on submit)
+	ovrPosef eyePoses[2];
+	ovr_GetEyePoses(_session, frame, true, _viewScaleDesc.HmdToEyePose, eyePoses, &_sceneLayer.SensorSampleTime);
+	ovr::for_each_eye([&](ovrEyeType eye) {
+		_sceneLayer.RenderPose[eye] = eyePoses[eye];
+		result.eyePoses[eye] = ovr::toGlm(eyePoses[eye]);
+	});
+
+	// Process controller position and orientation:
+	// These are position and orientation in meters in room coordinates, relative to tracking origin. Right-handed cartesian coordinates.
+	double displayMidpointSeconds = ovr_GetPredictedDisplayTime(_session, 0);
+	ovrTrackingState trackState = ovr_GetTrackingState(_session, displayMidpointSeconds, ovrTrue);
+	result.handPoses[ovrHand_Left] = ovr::toGlm(trackState.HandPoses[ovrHand_Left].ThePose);
+	result.handPoses[ovrHand_Right] = ovr::toGlm(trackState.HandPoses[ovrHand_Right].ThePose);
+
+	//Touch controllers
+	result.inputValid = sampleInput(result.input);
+
+	return result;
+}
+
+bool OculusBackend::sampleInput(InputState & state) {
+	//The SDK may be polled from the sampler thread while the render thread runs its frame
+	ovrInputState inputState;
+	if (!OVR_SUCCESS(ovr_GetInputState(_session, ovrControllerType_Touch, &inputState))) return false;
+
+	//Index Trigger
+	state.indexTriggerL = (inputState.IndexTrigger[ovrHand_Left] > 0.5f);
+	state.indexTriggerR = (inputState.IndexTrigger[ovrHand_Right] > 0.5f);
+
+	//Hand Trigger
+	state.handTriggerL = (inputState.HandTrigger[ovrHand_Left] > 0.5f);
+	state.handTriggerR = (inputState.HandTrigger[ovrHand_Right] > 0.5f);
+
+	//Buttons
+	state.buttonA = (inputState.Buttons & ovrButton_A) != 0;
+	state.buttonB = (inputState.Buttons & ovrButton_B) != 0;
+	state.buttonX = (inputState.Buttons & ovrButton_X) != 0;
+	state.buttonY = (inputState.Buttons & ovrButton_Y) != 0;
+
+	//Sticks
+	state.stickL = ovr::toGlm(inputState.Thumbstick[0]);
+	state.stickR = ovr::toGlm(inputState.Thumbstick[1]);
+	state.buttonStickL = (inputState.Buttons & ovrButton_LThumb) != 0;
+	state.buttonStickR = (inputState.Buttons & ovrButton_RThumb) != 0;
+	return true;
+}
+
+GLuint OculusBackend::getEyeTexture() {
+	int curIndex;
+	ovr_GetTextureSwapChainCurrentIndex(_session, _eyeTexture, &curIndex);
+	GLuint curTexId;
+	ovr_GetTextureSwapChainBufferGL(_session, _eyeTexture, curIndex, &curTexId);
+	return curTexId;
+}
+
+void OculusBackend::latchPoses(unsigned int frame, HmdFrame & poses, int eye) {
+	//Newest prediction for when this frame reaches the display
+	double displayTime = ovr_GetPredictedDisplayTime(_session, frame);
+	ovrTrackingState trackState = ovr_GetTrackingState(_session, displayTime, ovrTrue);
+	double sampleTime = ovr_GetTimeInSeconds();
+
+	ovrPosef eyePoses[2];
+	ovr_CalcEyePoses(trackState.HeadPose.ThePose, _viewScaleDesc.HmdToEyePose, eyePoses);
+	ovr::for_each_eye([&](ovrEyeType e) {
+		if (eye >= 0 && eye != e) return;
+		//The compositor timewarps from the pose the eye was actually rendered with
+		_sceneLayer.RenderPose[e] = eyePoses[e];
+		poses.eyePoses[e] = ovr::toGlm(eyePoses[e]);
+	});
+	_sceneLayer.SensorSampleTime = sampleTime;
+
+	poses.handPoses[ovrHand_Left] = ovr::toGlm(trackState.HandPoses[ovrHand_Left].ThePose);
+	poses.handPoses[ovrHand_Right] = ovr::toGlm(trackState.HandPoses[ovrHand_Right].ThePose);
+}
+
+void OculusBackend::submitFrame(unsigned int frame) {
+	ovr_CommitTextureSwapChain(_session, _eyeTexture);
+	ovrLayerHeader* headerList = &_sceneLayer.Header;
+	ovr_SubmitFrame(_session, frame, &_viewScaleDesc, &headerList, 1);
+}
+
+void OculusBackend::blitMirror(glm::uvec2 windowSize) {
+	GLuint mirrorTextureId;
+	ovr_GetMirrorTextureBufferGL(_session, _mirrorTexture, &mirrorTextureId);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, _mirrorFbo);
+	glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mirrorTextureId, 0);
+	glBlitFramebuffer(0, 0, mirrorSize.x, mirrorSize.y, 0, windowSize.y, windowSize.x, 0, GL_COLOR_BUFFER_BIT,
+		GL_NEAREST);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
+
+void OculusBackend::setPixelDensity(float density) {
+	HmdBackend::setPixelDensity(density);
+	//The compositor only samples the rendered part of the swap chain
+	ovr::for_each_eye([&](ovrEyeType eye) {
+		_sceneLayer.Viewport[eye].Pos = { viewports[eye].x, viewports[eye].y };
+		_sceneLayer.Viewport[eye].Size = { viewports[eye].z, viewports[eye].w };
+	});
+}
+
+void OculusBackend::recenter() {
+	ovr_RecenterTrackingOrigin(_session);
+}
+
+double OculusBackend::getTime() {
+	return ovr_GetTimeInSeconds();
+}
@@ -0,0 +1,43 @@
+#pragma once
+#ifndef OCULUS_BACKEND_H
+#define OCULUS_BACKEND_H
+
+#include "HmdBackend.h"
+
+#include <OVR_CAPI.h>
+#include <OVR_CAPI_GL.h>
+
+//Rift display through the Oculus SDK: swap chain, mirror texture and live tracking
+class OculusBackend : public HmdBackend {
+public:
+	OculusBackend(float maxDensity = 1.0f);	//the swap chain is allocated for this pixel density
+	~OculusBackend();
+
+	void initGl() override;
+	void shutdownGl() override;
+
+	HmdFrame beginFrame(unsigned int frame) override;
+	void latchPoses(unsigned int frame, HmdFrame & poses, int eye = -1) override;
+	bool sampleInput(InputState & state) override;
+	GLuint getEyeTexture() override;
+	void submitFrame(unsigned int frame) override;
+	void blitMirror(glm::uvec2 windowSize) override;
+	void recenter() override;
+	void setPixelDensity(float density) override;
+	double getTime() override;
+
+private:
+	ovrSession _session;
+	ovrHmdDesc _hmdDesc;
+	ovrGraphicsLuid _luid;
+
+	ovrTextureSwapChain _eyeTexture;
+	GLuint _mirrorFbo{ 0 };
+	ovrMirrorTexture _mirrorTexture;
+
+	ovrEyeRenderDesc _eyeRenderDescs[2];
+	ovrLayerEyeFov _sceneLayer;
+	ovrViewScaleDesc _viewScaleDesc;
+};
+
+#endif
@@ -0,0 +1,215 @@
+#include "PoseTrace.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//==============================================================================POSE CONVERSION
+static PoseTracePose packPose(const glm::mat4 & m) {
+	PoseTracePose pose;
+	glm::quat q = glm::quat_cast(m);
+
+	for (int i = 0; i < 3; i++) pose.position[i] = m[3][i];
+	pose.orientation[0] = q.x;
+	pose.orientation[1] = q.y;
+	pose.orientation[2] = q.z;
+	pose.orientation[3] = q.w;
+	return pose;
+}
+
+static glm::mat4 unpackPose(const PoseTracePose & pose) {
+	glm::quat q = glm::quat(pose.orientation[3], pose.orientation[0], pose.orientation[1], pose.orientation[2]);
+	glm::mat4 m = glm::mat4_cast(q);
+	m[3] = glm::vec4(pose.position[0], pose.position[1], pose.position[2], 1.0f);
+	return m;
+}
+
+//==============================================================================WRITER
+PoseTraceWriter::PoseTraceWriter(const char * path) {
+	file = fopen(path, "wb");
+	if (file == NULL) {
+		std::cerr << "Unable to open pose trace " << path << " for writing" << std::endl;
+		return;
+	}
+
+	//Frame count is patched on close
+	PoseTraceHeader header = { POSE_TRACE_MAGIC, POSE_TRACE_VERSION, (uint32_t)sizeof(PoseTraceRecord), 0 };
+	fwrite(&header, sizeof(header), 1, file);
+}
+
+PoseTraceWriter::~PoseTraceWriter() {
+	close();
+}
+
+void PoseTraceWriter::write(const HmdFrame & frame, const HmdFrame latched[POSE_TRACE_LATCHES], double time) {
+	if (file == NULL) return;
+
+	PoseTraceRecord record;
+	memset(&record, 0, sizeof(record));
+	record.time = time;
+	for (int i = 0; i < 2; i++) {
+		record.eyes[i] = packPose(frame.eyePoses[i]);
+		record.hands[i] = packPose(frame.handPoses[i]);
+		for (int latch = 0; latch < POSE_TRACE_LATCHES; latch++) {
+			record.latches[latch].eyes[i] = packPose(latched[latch].eyePoses[i]);
+			record.latches[latch].hands[i] = packPose(latched[latch].handPoses[i]);
+		}
+	}
+
+	const InputState & in = frame.input;
+	record.sticks[0] = in.stickL.x;
+	record.sticks[1] = in.stickL.y;
+	record.sticks[2] = in.stickR.x;
+	record.sticks[3] = in.stickR.y;
+
+	uint32_t buttons = 0;
+	if (frame.inputValid) buttons |= TRACE_INPUT_VALID;
+	if (in.indexTriggerL) buttons |= TRACE_INDEX_TRIGGER_L;
+	if (in.indexTriggerR) buttons |= TRACE_INDEX_TRIGGER_R;
+	if (in.handTriggerL) buttons |= TRACE_HAND_TRIGGER_L;
+	if (in.handTriggerR) buttons |= TRACE_HAND_TRIGGER_R;
+	if (in.buttonA) buttons |= TRACE_BUTTON_A;
+	if (in.buttonB) buttons |= TRACE_BUTTON_B;
+	if (in.buttonX) buttons |= TRACE_BUTTON_X;
+	if (in.buttonY) buttons |= TRACE_BUTTON_Y;
+	if (in.buttonStickL) buttons |= TRACE_BUTTON_STICK_L;
+	if (in.buttonStickR) buttons |= TRACE_BUTTON_STICK_R;
+	record.buttons = buttons;
+
+	fwrite(&record, sizeof(record), 1, file);
+	frameCount++;
+}
+
+void PoseTraceWriter::close() {
+	if (file == NULL) return;
+
+	fseek(file, offsetof(PoseTraceHeader, frameCount), SEEK_SET);
+	fwrite(&frameCount, sizeof(frameCount), 1, file);
+	fclose(file);
+	file = NULL;
+
+	std::cout << "Recorded " << frameCount << " frames of poses" << std::endl;
+}
+
+//==============================================================================READER
+PoseTraceReader::PoseTraceReader(const char * path) {
+#ifdef _WIN32
+	HANDLE fileH = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (fileH == INVALID_HANDLE_VALUE) {
+		std::cerr << "Unable to open pose trace " << path << std::endl;
+		return;
+	}
+	LARGE_INTEGER size;
+	GetFileSizeEx(fileH, &size);
+	HANDLE mappingH = CreateFileMappingA(fileH, NULL, PAGE_READONLY, 0, 0, NULL);
+	void * view = mappingH ? MapViewOfFile(mappingH, FILE_MAP_READ, 0, 0, 0) : NULL;
+	fileHandle = fileH;
+	mappingHandle = mappingH;
+	mapping = view;
+	mappingSize = (size_t)size.QuadPart;
+#else
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		std::cerr << "Unable to open pose trace " << path << std::endl;
+		return;
+	}
+	struct stat info;
+	fstat(fd, &info);
+	void * view = (info.st_size > 0) ? mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+	close(fd);
+	mapping = (view == MAP_FAILED) ? NULL : view;
+	mappingSize = (size_t)info.st_size;
+#endif
+
+	if (mapping == NULL) {
+		std::cerr << "Unable to map pose trace " << path << std::endl;
+		unmap();
+		return;
+	}
+
+	//Header must match this build's record layout
+	const PoseTraceHeader * header = (const PoseTraceHeader *)mapping;
+	if (mappingSize < sizeof(PoseTraceHeader) || header->magic != POSE_TRACE_MAGIC || header->version != POSE_TRACE_VERSION || header->recordSize != sizeof(PoseTraceRecord)) {
+		std::cerr << "Pose trace " << path << " has an unsupported format" << std::endl;
+		unmap();
+		return;
+	}
+
+	//A trace that was never closed still has whole records to replay
+	size_t available = (mappingSize - sizeof(PoseTraceHeader)) / sizeof(PoseTraceRecord);
+	frameCount = header->frameCount;
+	if (frameCount == 0 || frameCount > available) frameCount = (unsigned int)available;
+	records = (const PoseTraceRecord *)((const char *)mapping + sizeof(PoseTraceHeader));
+
+	std::cout << "Replaying " << frameCount << " frames from " << path << std::endl;
+}
+
+PoseTraceReader::~PoseTraceReader() {
+	unmap();
+}
+
+HmdFrame PoseTraceReader::read(unsigned int index, double & time) {
+	HmdFrame frame;
+	const PoseTraceRecord & record = records[index];
+
+	time = record.time;
+	for (int i = 0; i < 2; i++) {
+		frame.eyePoses[i] = unpackPose(record.eyes[i]);
+		frame.handPoses[i] = unpackPose(record.hands[i]);
+	}
+
+	uint32_t buttons = record.buttons;
+	InputState & in = frame.input;
+	frame.inputValid = (buttons & TRACE_INPUT_VALID) != 0;
+	in.indexTriggerL = (buttons & TRACE_INDEX_TRIGGER_L) != 0;
+	in.indexTriggerR = (buttons & TRACE_INDEX_TRIGGER_R) != 0;
+	in.handTriggerL = (buttons & TRACE_HAND_TRIGGER_L) != 0;
+	in.handTriggerR = (buttons & TRACE_HAND_TRIGGER_R) != 0;
+	in.buttonA = (buttons & TRACE_BUTTON_A) != 0;
+	in.buttonB = (buttons & TRACE_BUTTON_B) != 0;
+	in.buttonX = (buttons & TRACE_BUTTON_X) != 0;
+	in.buttonY = (buttons & TRACE_BUTTON_Y) != 0;
+	in.buttonStickL = (buttons & TRACE_BUTTON_STICK_L) != 0;
+	in.buttonStickR = (buttons & TRACE_BUTTON_STICK_R) != 0;
+	in.stickL = glm::vec2(record.sticks[0], record.sticks[1]);
+	in.stickR = glm::vec2(record.sticks[2], record.sticks[3]);
+
+	return frame;
+}
+
+void PoseTraceReader::readLatch(unsigned int index, int eye, HmdFrame & poses) {
+	//Same poses the live latch changed: the hands and the latched eyes
+	const PoseTraceLatch & latch = records[index].latches[poseTraceLatch(eye)];
+	for (int i = 0; i < 2; i++) {
+		if (eye < 0 || eye == i) poses.eyePoses[i] = unpackPose(latch.eyes[i]);
+		poses.handPoses[i] = unpackPose(latch.hands[i]);
+	}
+}
+
+void PoseTraceReader::unmap() {
+#ifdef _WIN32
+	if (mapping) UnmapViewOfFile(mapping);
+	if (mappingHandle) CloseHandle((HANDLE)mappingHandle);
+	if (fileHandle) CloseHandle((HANDLE)fileHandle);
+	mappingHandle = NULL;
+	fileHandle = NULL;
+#else
+	if (mapping) munmap(mapping, mappingSize);
+#endif
+	mapping = NULL;
+	mappingSize = 0;
+	records = NULL;
+	frameCount = 0;
+}
@@ -0,0 +1,100 @@
+#pragma once
+#ifndef POSE_TRACE_H
+#define POSE_TRACE_H
+
+#include <glm/glm.hpp>
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "HmdBackend.h"
+
+//Binary pose trace: a header followed by one fixed-size record per frame (native byte order)
+#define POSE_TRACE_MAGIC 0x43525450		//"PTRC"
+#define POSE_TRACE_VERSION 2
+#define POSE_TRACE_LATCHES 3		//latchPoses() calls kept per frame: both eyes, then the left and the right eye alone
+
+//Bits of PoseTraceRecord::buttons
+#define TRACE_INPUT_VALID (1 << 0)
+#define TRACE_INDEX_TRIGGER_L (1 << 1)
+#define TRACE_INDEX_TRIGGER_R (1 << 2)
+#define TRACE_HAND_TRIGGER_L (1 << 3)
+#define TRACE_HAND_TRIGGER_R (1 << 4)
+#define TRACE_BUTTON_A (1 << 5)
+#define TRACE_BUTTON_B (1 << 6)
+#define TRACE_BUTTON_X (1 << 7)
+#define TRACE_BUTTON_Y (1 << 8)
+#define TRACE_BUTTON_STICK_L (1 << 9)
+#define TRACE_BUTTON_STICK_R (1 << 10)
+
+struct PoseTraceHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t recordSize;
+	uint32_t frameCount;
+};
+
+//Rigid pose: position and orientation quaternion (x, y, z, w)
+struct PoseTracePose {
+	float position[3];
+	float orientation[4];
+};
+
+//Every pose of a frame after one late latch
+struct PoseTraceLatch {
+	PoseTracePose eyes[2];
+	PoseTracePose hands[2];
+};
+
+struct PoseTraceRecord {
+	double time;				//backend clock (seconds)
+	PoseTracePose eyes[2];		//as sampled by beginFrame(), with the input
+	PoseTracePose hands[2];
+	PoseTraceLatch latches[POSE_TRACE_LATCHES];	//what the frame was rendered with, see poseTraceLatch()
+	float sticks[4];			//left x, y, right x, y
+	uint32_t buttons;
+};
+
+//Index into PoseTraceRecord::latches of a latchPoses() call for the given eye (both when eye < 0)
+inline int poseTraceLatch(int eye) { return eye < 0 ? 0 : 1 + eye; }
+
+//Appends frames to a trace file. The frame count in the header is written on close.
+class PoseTraceWriter {
+public:
+	PoseTraceWriter(const char * path);
+	~PoseTraceWriter();
+
+	bool isOpen() { return file != NULL; }
+	void write(const HmdFrame & frame, const HmdFrame latched[POSE_TRACE_LATCHES], double time);
+	void close();
+
+private:
+	FILE * file = NULL;
+	uint32_t frameCount = 0;
+};
+
+//Memory-mapped view of a trace file. Records are read in place, nothing is copied up front.
+class PoseTraceReader {
+public:
+	PoseTraceReader(const char * path);
+	~PoseTraceReader();
+
+	bool isOpen() { return records != NULL; }
+	unsigned int getFrameCount() { return frameCount; }
+	HmdFrame read(unsigned int index, double & time);
+	void readLatch(unsigned int index, int eye, HmdFrame & poses);	//the poses the recorded latch for eye returned
+
+private:
+	const PoseTraceRecord * records = NULL;
+	unsigned int frameCount = 0;
+	void * mapping = NULL;		//start of the mapped file
+	size_t mappingSize = 0;
+#ifdef _WIN32
+	void * fileHandle = NULL;
+	void * mappingHandle = NULL;
+#endif
+
+	void unmap();
+};
+
+#endif
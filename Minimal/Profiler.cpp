@@ -0,0 +1,252 @@
+#include "Profiler.h"
+
+#include <chrono>
+#include <iostream>
+
+bool Profiler::enabled = false;
+FILE * Profiler::trace = NULL;
+FILE * Profiler::csv = NULL;
+Profiler::Frame Profiler::frames[PROFILER_FRAMES];
+int Profiler::current = 0;
+int Profiler::depth = 0;
+bool Profiler::queriesCreated = false;
+double Profiler::startTime = 0.0;
+GLint64 Profiler::gpuBase = 0;
+double Profiler::cpuBase = 0.0;
+std::map<std::string, Profiler::Rolling> Profiler::rolling;
+unsigned int Profiler::drawCalls = 0;
+
+#define TRACE_TID_CPU 1
+#define TRACE_TID_GPU 2
+
+//==============================================================================SETUP
+bool Profiler::open(const char * tracePath, const char * csvPath) {
+	//Frames timed so far belong to the old time base
+	flush();
+
+	if (tracePath) trace = fopen(tracePath, "w");
+	if (csvPath) csv = fopen(csvPath, "w");
+	if ((tracePath && trace == NULL) || (csvPath && csv == NULL)) {
+		std::cerr << "Unable to open profiler output " << (trace ? csvPath : tracePath) << std::endl;
+		if (trace) fclose(trace);
+		if (csv) fclose(csv);
+		trace = csv = NULL;
+		return false;
+	}
+
+	if (trace) {
+		fprintf(trace, "[\n");
+		fprintf(trace, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"CPU\"}},\n", TRACE_TID_CPU);
+		fprintf(trace, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"GPU\"}}", TRACE_TID_GPU);
+	}
+	if (csv) fprintf(csv, "frame,stage,cpu_ms,gpu_ms,gpu_avg_ms\n");
+
+	startTime = 0.0;
+	startTime = now();
+	if (queriesCreated) {
+		glGetInteger64v(GL_TIMESTAMP, &gpuBase);
+		cpuBase = now();
+	}
+	enabled = true;
+	return true;
+}
+
+void Profiler::close() {
+	flush();
+
+	if (queriesCreated) {
+		for (int i = 0; i < PROFILER_FRAMES; i++) glDeleteQueries(PROFILER_MAX_SCOPES * 2, frames[i].queries);
+		queriesCreated = false;
+	}
+
+	if (trace) {
+		fprintf(trace, "\n]\n");
+		fclose(trace);
+	}
+	if (csv) fclose(csv);
+	trace = csv = NULL;
+	enabled = false;
+	rolling.clear();
+}
+
+void Profiler::flush() {
+	//Oldest first, so the outputs stay in frame order
+	for (int i = 1; i <= PROFILER_FRAMES; i++) {
+		Frame & frame = frames[(current + i) % PROFILER_FRAMES];
+		if (frame.pending) resolve(frame, true);
+	}
+}
+
+double Profiler::now() {
+	using namespace std::chrono;
+	return duration<double, std::micro>(steady_clock::now().time_since_epoch()).count() - startTime;
+}
+
+//==============================================================================FRAMES
+void Profiler::beginFrame(unsigned int number) {
+	if (!queriesCreated) {
+		for (int i = 0; i < PROFILER_FRAMES; i++) glGenQueries(PROFILER_MAX_SCOPES * 2, frames[i].queries);
+		queriesCreated = true;
+
+		//Anchor the GPU clock to the CPU clock once; both tracks then share a time base
+		glGetInteger64v(GL_TIMESTAMP, &gpuBase);
+		cpuBase = now();
+	}
+
+	//Oldest slot is reused, so its results are read (or given up on) first
+	current = (current + 1) % PROFILER_FRAMES;
+	Frame & frame = frames[current];
+	if (frame.pending) resolve(frame, false);
+
+	frame.number = number;
+	frame.pending = true;
+	frame.scopes.clear();
+	frame.counters.clear();
+	depth = 0;
+}
+
+void Profiler::endFrame() {
+	if (depth != 0) std::cerr << "Profiler: " << depth << " scopes still open at end of frame" << std::endl;
+	if (trace) fflush(trace);
+	if (csv) fflush(csv);
+}
+
+unsigned int Profiler::takeDrawCalls() {
+	unsigned int count = drawCalls;
+	drawCalls = 0;
+	return count;
+}
+
+int Profiler::beginScope(const char * name, int index) {
+	if (!queriesCreated) return -1;
+
+	Frame & frame = frames[current];
+	int scope = (int)frame.scopes.size();
+	if (scope >= PROFILER_MAX_SCOPES) return -1;
+
+	Scope s;
+	s.name = name;
+	s.index = index;
+	s.depth = depth++;
+	s.cpuStart = now();
+	s.cpuEnd = s.cpuStart;
+	frame.scopes.push_back(s);
+
+	glQueryCounter(frame.queries[scope * 2], GL_TIMESTAMP);
+	return scope;
+}
+
+void Profiler::endScope(int scope) {
+	if (scope < 0) return;
+
+	Frame & frame = frames[current];
+	glQueryCounter(frame.queries[scope * 2 + 1], GL_TIMESTAMP);
+	frame.scopes[scope].cpuEnd = now();
+	depth--;
+}
+
+void Profiler::counter(const char * name, double value) {
+	if (!enabled) return;
+
+	Counter c;
+	c.name = name;
+	c.value = value;
+	c.cpuTime = now();
+	frames[current].counters.push_back(c);
+}
+
+//==============================================================================OUTPUT
+void Profiler::resolve(Frame & frame, bool wait) {
+	frame.pending = false;
+	for (const Counter & c : frame.counters) writeCounter(c, frame.number);
+
+	int count = (int)frame.scopes.size();
+	if (count == 0) return;
+
+	//Timestamps complete in order, so the frame's last query tells whether all are ready
+	GLint available = GL_TRUE;
+	if (!wait) glGetQueryObjectiv(frame.queries[count * 2 - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+
+	for (int i = 0; i < count; i++) {
+		const Scope & s = frame.scopes[i];
+		std::string label = s.name;
+		if (s.index >= 0) label += " " + std::to_string(s.index);
+
+		double cpuDuration = s.cpuEnd - s.cpuStart;
+		writeEvent(label, TRACE_TID_CPU, s.cpuStart, cpuDuration, frame.number);
+
+		double gpuDuration = -1.0;
+		if (available) {
+			GLuint64 start, end;
+			glGetQueryObjectui64v(frame.queries[i * 2], GL_QUERY_RESULT, &start);
+			glGetQueryObjectui64v(frame.queries[i * 2 + 1], GL_QUERY_RESULT, &end);
+			gpuDuration = (double)(end - start) / 1000.0;
+			writeEvent(label, TRACE_TID_GPU, cpuBase + (double)((GLint64)start - gpuBase) / 1000.0, gpuDuration, frame.number);
+		}
+
+		//Rolling GPU average per stage; frames the GPU was too far behind on are left out
+		Rolling & r = rolling[label];
+		if (gpuDuration >= 0.0) {
+			float ms = (float)(gpuDuration / 1000.0);
+			if (r.count == PROFILER_WINDOW) r.sum -= r.values[r.next];
+			else r.count++;
+			r.values[r.next] = ms;
+			r.sum += ms;
+			r.next = (r.next + 1) % PROFILER_WINDOW;
+			r.lastGpu = ms;
+			r.lastFrame = frame.number;
+		}
+		float average = r.count > 0 ? r.sum / r.count : -1.0f;
+		double gpuMs = gpuDuration >= 0.0 ? gpuDuration / 1000.0 : -1.0;
+
+		r.cpuTotal += cpuDuration / 1000.0;
+		r.cpuSamples++;
+		if (gpuMs >= 0.0) {
+			r.gpuTotal += gpuMs;
+			r.gpuSamples++;
+		}
+
+		if (csv) fprintf(csv, "%u,%s,%.4f,%.4f,%.4f\n", frame.number, label.c_str(), cpuDuration / 1000.0, gpuMs, average);
+	}
+}
+
+std::vector<ProfileStage> Profiler::getStages() {
+	std::vector<ProfileStage> stages;
+	for (const auto & entry : rolling) {
+		const Rolling & r = entry.second;
+		if (r.cpuSamples == 0) continue;
+
+		ProfileStage stage;
+		stage.label = entry.first;
+		stage.cpuAverage = (float)(r.cpuTotal / r.cpuSamples);
+		stage.gpuAverage = r.gpuSamples > 0 ? (float)(r.gpuTotal / r.gpuSamples) : -1.0f;
+		stage.samples = r.cpuSamples;
+		stages.push_back(stage);
+	}
+	return stages;
+}
+
+void Profiler::resetStages() {
+	rolling.clear();
+}
+
+bool Profiler::getGpuTime(const char * label, float & ms, unsigned int & frame) {
+	auto it = rolling.find(label);
+	if (it == rolling.end() || it->second.lastGpu < 0.0f) return false;
+	ms = it->second.lastGpu;
+	frame = it->second.lastFrame;
+	return true;
+}
+
+void Profiler::writeEvent(const std::string & label, int tid, double start, double duration, unsigned int frame) {
+	if (trace == NULL) return;
+
+	//Metadata events open the array, so every event follows a comma
+	fprintf(trace, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%u}}",
+		label.c_str(), tid, start, duration, frame);
+}
+
+void Profiler::writeCounter(const Counter & c, unsigned int frame) {
+	if (trace) fprintf(trace, ",\n{\"name\":\"%s\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{\"value\":%.4f}}", c.name, c.cpuTime, c.value);
+	if (csv) fprintf(csv, "%u,%s,%.4f,-1,-1\n", frame, c.name, c.value);
+}
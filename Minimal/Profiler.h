@@ -0,0 +1,130 @@
+#pragma once
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <GL/glew.h>
+
+#include <stdio.h>
+#include <map>
+#include <string>
+#include <vector>
+
+//Frames of queries in flight. A frame's GPU times are read when its slot comes around
+//again; if the GPU still has not reached them they are dropped instead of waited for.
+#define PROFILER_FRAMES 4
+#define PROFILER_MAX_SCOPES 64		//per frame
+#define PROFILER_WINDOW 90			//frames in the rolling average of the CSV
+
+//Mean times of one stage since the last resetStages()
+struct ProfileStage {
+	std::string label;
+	float cpuAverage;	//milliseconds
+	float gpuAverage;	//milliseconds, -1 when no GPU result arrived
+	int samples;
+};
+
+//Per-stage CPU and GPU timing. Scopes nest, and every scope is bracketed by a pair of
+//GL_TIMESTAMP queries (unlike GL_TIME_ELAPSED these may nest and interleave). Timing always
+//runs, so code can act on its own stages' GPU times (getGpuTime()). Once open(), finished
+//frames are also appended to a Chrome trace (chrome://tracing, one CPU and one GPU track)
+//and to a CSV with a rolling average per stage (counters have -1 for both GPU columns). Either file may be NULL to only keep the
+//per-stage averages in memory.
+class Profiler {
+public:
+	static bool open(const char * tracePath, const char * csvPath);
+	static void close();	//also releases the queries, call it before the context goes away
+	static bool isEnabled() { return enabled; }	//outputs are open
+	static void flush();	//waits for the frames in flight (for shutdown and benchmarks, not per frame)
+
+	//Per-stage means since the last reset
+	static std::vector<ProfileStage> getStages();
+	static void resetStages();
+	//Newest GPU time of a stage (milliseconds) and the frame it was measured in, false while there is none.
+	//A frame's times arrive PROFILER_FRAMES frames later, or never when the GPU was that far behind.
+	static bool getGpuTime(const char * label, float & ms, unsigned int & frame);
+	static unsigned int getFrame() { return frames[current].number; }
+
+	//Draw calls issued since the last take (counted even while disabled)
+	static void countDraw() { drawCalls++; }
+	static unsigned int takeDrawCalls();
+
+	static void beginFrame(unsigned int frame);
+	static void endFrame();
+
+	static int beginScope(const char * name, int index);
+	static void endScope(int scope);
+
+	//A value of the current frame (e.g. time saved by skipped work): a Chrome trace counter and a CSV row
+	static void counter(const char * name, double value);
+
+private:
+	struct Scope {
+		const char * name;
+		int index;			//appended to the name when >= 0 (e.g. the wall number)
+		int depth;
+		double cpuStart;	//microseconds since open()
+		double cpuEnd;
+	};
+
+	struct Counter {
+		const char * name;
+		double value;
+		double cpuTime;		//microseconds since open()
+	};
+
+	struct Frame {
+		unsigned int number = 0;
+		bool pending = false;
+		std::vector<Scope> scopes;
+		std::vector<Counter> counters;
+		GLuint queries[PROFILER_MAX_SCOPES * 2];
+	};
+
+	struct Rolling {
+		float values[PROFILER_WINDOW];
+		int count = 0;
+		int next = 0;
+		float sum = 0.0f;
+		double cpuTotal = 0.0;
+		double gpuTotal = 0.0;
+		int cpuSamples = 0;
+		int gpuSamples = 0;
+		float lastGpu = -1.0f;		//milliseconds
+		unsigned int lastFrame = 0;
+	};
+
+	static bool enabled;
+	static FILE * trace;
+	static FILE * csv;
+	static Frame frames[PROFILER_FRAMES];
+	static int current;
+	static int depth;
+	static bool queriesCreated;
+	static double startTime;	//CPU clock at open()
+	static GLint64 gpuBase;		//GPU timestamp matching cpuBase
+	static double cpuBase;
+	static std::map<std::string, Rolling> rolling;
+	static unsigned int drawCalls;
+
+	static double now();
+	static void resolve(Frame & frame, bool wait);
+	static void writeEvent(const std::string & label, int tid, double start, double duration, unsigned int frame);
+	static void writeCounter(const Counter & c, unsigned int frame);
+};
+
+//Times the enclosing block
+class ProfileScope {
+public:
+	ProfileScope(const char * name, int index = -1) : scope(Profiler::beginScope(name, index)) { }
+	~ProfileScope() { Profiler::endScope(scope); }
+
+private:
+	int scope;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_SCOPE_INDEXED(name, index) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name, index)
+
+#endif
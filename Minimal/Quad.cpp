@@ -1,10 +1,17 @@
 #include "Quad.h"
+#include "GLState.h"
+#include "Profiler.h"
 
 Quad::Quad(float size){
 	initPlane(size);
 	initBuffers();
 }
 
+Quad::Quad(glm::vec3 lowerLeft, glm::vec3 lowerRight, glm::vec3 upperLeft){
+	initPlane(lowerLeft, lowerRight, upperLeft);
+	initBuffers();
+}
+
 
 Quad::~Quad(){
 	indices.clear();
@@ -17,65 +24,38 @@ Quad::~Quad(){
 	glDeleteBuffers(1, &VBO2);
 }
 
-void Quad::draw(glm::mat4 projection, glm::mat4 headPose, GLint shader, glm::mat4 M, GLuint texture, glm::vec3 eye) {
-	glm::mat4 m = M * toWorld;
-
-	glUseProgram(shader);
-	glEnable(GL_CULL_FACE);
-	glCullFace(GL_BACK);
-
-	glUniform1i(glGetUniformLocation(shader, "TexCoords"), 0);
-	glUniform3f(glGetUniformLocation(shader, "eye"), eye.x, eye.y, eye.z);
-	glUniformMatrix4fv(glGetUniformLocation(shader, "projection"), 1, GL_FALSE, &projection[0][0]);
-	glUniformMatrix4fv(glGetUniformLocation(shader, "view"), 1, GL_FALSE, &headPose[0][0]);
-	glUniformMatrix4fv(glGetUniformLocation(shader, "model"), 1, GL_FALSE, &m[0][0]);
-
-	glBindVertexArray(VAO);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, texture);
-	glDrawElements(GL_TRIANGLES, (GLsizei)indices.size(), GL_UNSIGNED_INT, 0);
-
-	glBindVertexArray(0);
-}
-
-void Quad::draw(glm::mat4 projection, glm::mat4 headPose, GLint shader, glm::mat4 M, GLuint texture, glm::vec3 normal, glm::vec3 eyepos) {
-	glm::mat4 m = M * toWorld;
-
-	glUseProgram(shader);
-	glEnable(GL_CULL_FACE);
-	glCullFace(GL_BACK);
-
-	glUniform1i(glGetUniformLocation(shader, "TexCoords"), 0);
-	glUniform3f(glGetUniformLocation(shader, "planeNormal"), normal.x, normal.y, normal.z);
-	glUniform3f(glGetUniformLocation(shader, "eyePos"), eyepos.x, eyepos.y, eyepos.z);
-	glUniformMatrix4fv(glGetUniformLocation(shader, "projection"), 1, GL_FALSE, &projection[0][0]);
-	glUniformMatrix4fv(glGetUniformLocation(shader, "view"), 1, GL_FALSE, &headPose[0][0]);
-	glUniformMatrix4fv(glGetUniformLocation(shader, "model"), 1, GL_FALSE, &m[0][0]);
-
-	glBindVertexArray(VAO);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, texture);
-	glDrawElements(GL_TRIANGLES, (GLsizei)indices.size(), GL_UNSIGNED_INT, 0);
-
-	glBindVertexArray(0);
+void Quad::submit(const ShaderProgram & shader, glm::mat4 M, GLuint texture, GLint layer, glm::vec3 normal, float texScale) {
+	RenderPacket packet;
+	packet.shader = &shader;
+	packet.vao = VAO;
+	packet.count = (GLsizei)indices.size();
+	packet.textureTarget = GL_TEXTURE_2D_ARRAY;
+	packet.texture = texture;
+	packet.model = M * toWorld;
+	packet.layer = layer;
+	packet.normal = normal;
+	packet.texScale = texScale;
+
+	//Depth order by the wall centroid
+	glm::vec3 center = glm::vec3(0.0f);
+	for (const glm::vec3 & v : vertices) center += v;
+	packet.center = glm::vec3(packet.model * glm::vec4(center / (float)vertices.size(), 1.0f));
+	RenderQueue::submit(RENDER_PASS_OPAQUE, packet);
 }
 
-void Quad::draw(glm::mat4 projection, glm::mat4 headPose, GLint shader, glm::mat4 M, glm::vec3 rgb) {
+void Quad::draw(const ShaderProgram & shader, glm::mat4 M, glm::vec3 rgb) {
 	glm::mat4 m = M * toWorld;
 
-	glUseProgram(shader);
-	glEnable(GL_CULL_FACE);
-	glCullFace(GL_BACK);
+	shader.use();
+	GLState::enable(GL_CULL_FACE);
+	GLState::cullFace(GL_BACK);
 
-	glUniformMatrix4fv(glGetUniformLocation(shader, "projection"), 1, GL_FALSE, &projection[0][0]);
-	glUniformMatrix4fv(glGetUniformLocation(shader, "view"), 1, GL_FALSE, &headPose[0][0]);
-	glUniformMatrix4fv(glGetUniformLocation(shader, "model"), 1, GL_FALSE, &m[0][0]);
-	glUniform3f(glGetUniformLocation(shader, "rgb"), rgb.x, rgb.y, rgb.z);
+	glUniformMatrix4fv(shader.get(UNIFORM_MODEL), 1, GL_FALSE, &m[0][0]);
+	glUniform3f(shader.get(UNIFORM_RGB), rgb.x, rgb.y, rgb.z);
 
-	glBindVertexArray(VAO);
+	GLState::bindVertexArray(VAO);
 	glDrawElements(GL_TRIANGLES, (GLsizei)indices.size(), GL_UNSIGNED_INT, 0);
-
-	glBindVertexArray(0);
+	Profiler::countDraw();
 }
 
 void Quad::update() { }
@@ -98,6 +78,22 @@ void Quad::initPlane(float size) {
 	texCoords.push_back(glm::vec2(1, 1)); texCoords.push_back(glm::vec2(0, 1));
 }
 
+void Quad::initPlane(glm::vec3 lowerLeft, glm::vec3 lowerRight, glm::vec3 upperLeft) {
+	//Vertices (already in world space)
+	vertices.push_back(lowerLeft);								//left, down
+	vertices.push_back(lowerRight);								//right, down
+	vertices.push_back(lowerRight + upperLeft - lowerLeft);	//right, top
+	vertices.push_back(upperLeft);								//left, top
+
+	//indices
+	indices.push_back(0); indices.push_back(1); indices.push_back(2);
+	indices.push_back(0); indices.push_back(2); indices.push_back(3);
+
+	//Tex Coords
+	texCoords.push_back(glm::vec2(0, 0)); texCoords.push_back(glm::vec2(1, 0));
+	texCoords.push_back(glm::vec2(1, 1)); texCoords.push_back(glm::vec2(0, 1));
+}
+
 void Quad::initBuffers() {
 	glGenVertexArrays(1, &VAO);
 	glGenBuffers(1, &VBO);
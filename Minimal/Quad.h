@@ -11,17 +11,21 @@
 #include <string>
 #include <vector>
 
+#include "RenderQueue.h"
+
 class Quad{
 public:
 	Quad(float size);
+	Quad(glm::vec3 lowerLeft, glm::vec3 lowerRight, glm::vec3 upperLeft);
 	~Quad();
 	
 	glm::mat4 toWorld = glm::mat4(1.0f);
 	std::vector<glm::vec3> vertices;
 
-	void draw(glm::mat4 projection, glm::mat4 headPose, GLint shader, glm::mat4 M, GLuint texture, glm::vec3 eye);
-	void draw(glm::mat4 projection, glm::mat4 headPose, GLint shader, glm::mat4 M, glm::vec3 rgb);
-	void draw(glm::mat4 projection, glm::mat4 headPose, GLint shader, glm::mat4 M, GLuint texture, glm::vec3 normal, glm::vec3 eyepos);
+	//Immediately, for the stencil passes (camera from Shaders::setCamera)
+	void draw(const ShaderProgram & shader, glm::mat4 M, glm::vec3 rgb);
+	//Wall composites to the RenderQueue: eye position and warps come from the bound CaveEye uniform block
+	void submit(const ShaderProgram & shader, glm::mat4 M, GLuint texture, GLint layer, glm::vec3 normal, float texScale);
 	void update();
 
 private:
@@ -31,6 +35,7 @@ private:
 	GLuint VBO, VAO, EBO, VBO2;
 
 	void initPlane(float size);
+	void initPlane(glm::vec3 lowerLeft, glm::vec3 lowerRight, glm::vec3 upperLeft);
 	void initBuffers();
 };
 
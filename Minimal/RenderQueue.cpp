@@ -0,0 +1,234 @@
+#include "RenderQueue.h"
+#include "GLState.h"
+#include "Profiler.h"
+#include "Shaders.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+
+glm::mat4 RenderQueue::viewProjection = glm::mat4(1.0f);
+std::vector<RenderPacket> RenderQueue::packets;
+std::vector<RenderQueue::SortEntry> RenderQueue::entries;
+std::vector<RenderQueue::SortEntry> RenderQueue::scratch;
+std::vector<RenderQueue::Batch> RenderQueue::batches;
+StreamBuffer RenderQueue::instances(GL_ARRAY_BUFFER, RENDER_MAX_INSTANCES * sizeof(RenderQueue::Instance));
+bool RenderQueue::streaming = false;
+unsigned int RenderQueue::spilled = 0;
+
+//Key fields, from the most significant bit down
+#define KEY_PASS_SHIFT 62
+#define KEY_PROGRAM_SHIFT 52
+#define KEY_TEXTURE_SHIFT 40
+#define KEY_VAO_SHIFT 24
+#define KEY_PROGRAM_MASK 0x3FFull
+#define KEY_TEXTURE_MASK 0xFFFull
+#define KEY_VAO_MASK 0xFFFull
+#define KEY_DEPTH_MASK 0xFFFFFFull
+
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+
+//==============================================================================SETUP
+void RenderQueue::initGl() {
+	instances.initGl();
+}
+
+void RenderQueue::shutdownGl() {
+	instances.shutdownGl();
+	streaming = false;
+}
+
+//==============================================================================SUBMIT
+void RenderQueue::begin(const glm::mat4 & view, const glm::mat4 & projection) {
+	packets.clear();
+	entries.clear();
+	viewProjection = projection * view;
+	Shaders::setCamera(view, projection);
+}
+
+void RenderQueue::submit(RenderPass pass, const RenderPacket & packet) {
+	SortEntry entry;
+	entry.key = makeKey(pass, packet);
+	entry.index = (uint32_t)packets.size();
+	packets.push_back(packet);
+	entries.push_back(entry);
+}
+
+uint64_t RenderQueue::makeKey(RenderPass pass, const RenderPacket & packet) {
+	//Clip w is the distance along the view direction, for the off-axis wall projections as well
+	float w = (viewProjection * glm::vec4(packet.center, 1.0f)).w;
+	float depth = std::min(std::max(w / RENDER_DEPTH_FAR, 0.0f), 1.0f);
+
+	//GL names are small, the masks only matter to keep a stray one out of the neighbouring field
+	uint64_t key = (uint64_t)pass << KEY_PASS_SHIFT;
+	key |= ((uint64_t)packet.shader->getProgram() & KEY_PROGRAM_MASK) << KEY_PROGRAM_SHIFT;
+	key |= ((uint64_t)packet.texture & KEY_TEXTURE_MASK) << KEY_TEXTURE_SHIFT;
+	key |= ((uint64_t)packet.vao & KEY_VAO_MASK) << KEY_VAO_SHIFT;
+	key |= (uint64_t)(depth * KEY_DEPTH_MASK);
+	return key;
+}
+
+//==============================================================================SORT
+void RenderQueue::sort() {
+	//LSD radix sort, stable, so equal keys keep their submit order. A digit every key
+	//shares (most of the high ones, with a handful of programs and meshes) is skipped.
+	size_t n = entries.size();
+	scratch.resize(n);
+	for (int shift = 0; shift < 64; shift += RADIX_BITS) {
+		size_t counts[RADIX_BUCKETS] = { 0 };
+		for (const SortEntry & e : entries) counts[(e.key >> shift) & (RADIX_BUCKETS - 1)]++;
+		if (counts[(entries[0].key >> shift) & (RADIX_BUCKETS - 1)] == n) continue;
+
+		size_t offset = 0;
+		for (int b = 0; b < RADIX_BUCKETS; b++) {
+			size_t count = counts[b];
+			counts[b] = offset;
+			offset += count;
+		}
+		for (const SortEntry & e : entries) scratch[counts[(e.key >> shift) & (RADIX_BUCKETS - 1)]++] = e;
+		entries.swap(scratch);
+	}
+}
+
+//==============================================================================BATCH
+bool RenderQueue::sameBatch(const SortEntry & a, const SortEntry & b) {
+	//Everything but the instance attributes has to match, uniforms included
+	const RenderPacket & p = packets[a.index];
+	const RenderPacket & q = packets[b.index];
+	return (a.key >> KEY_PASS_SHIFT) == (b.key >> KEY_PASS_SHIFT) && p.instanced && q.instanced
+		&& p.shader == q.shader && p.vao == q.vao && p.mode == q.mode && p.count == q.count && p.indexed == q.indexed
+		&& p.textureTarget == q.textureTarget && p.texture == q.texture && p.cullFace == q.cullFace
+		&& p.layer == q.layer && p.normal == q.normal && p.texScale == q.texScale;
+}
+
+void RenderQueue::batch() {
+	//The sort already put packets of one mesh and program next to each other
+	batches.clear();
+	uint32_t n = (uint32_t)entries.size();
+	for (uint32_t i = 0; i < n;) {
+		Batch b;
+		b.first = i;
+		b.count = 1;
+		b.offset = -1;
+		while (i + b.count < n && sameBatch(entries[i], entries[i + b.count])) b.count++;
+		batches.push_back(b);
+		i += b.count;
+	}
+}
+
+void RenderQueue::upload() {
+	bool any = false;
+	for (const Batch & b : batches) any |= packets[entries[b.first].index].instanced;
+	if (!any) return;
+
+	//First upload of the frame takes the next region, later views append to it
+	if (streaming) instances.resume();
+	else instances.begin();
+	streaming = true;
+
+	for (Batch & b : batches) {
+		if (!packets[entries[b.first].index].instanced) continue;
+		GLintptr offset = 0;
+		Instance * data = (Instance *)instances.allocate(b.count * sizeof(Instance), offset);
+		if (data == NULL) {
+			if (spilled == 0) std::cerr << "RenderQueue: more than " << RENDER_MAX_INSTANCES << " instances in a frame, drawing the rest one by one" << std::endl;
+			spilled += b.count;
+			continue;
+		}
+		for (uint32_t i = 0; i < b.count; i++) {
+			const RenderPacket & packet = packets[entries[b.first + i].index];
+			data[i].model = packet.model;
+			data[i].rgb = packet.rgb;
+		}
+		b.offset = offset;
+	}
+	instances.end();
+}
+
+//==============================================================================DRAW
+void RenderQueue::flush() {
+	if (entries.empty()) return;
+
+	sort();
+	batch();
+	upload();
+
+	for (const Batch & b : batches) {
+		RenderPass pass = (RenderPass)(entries[b.first].key >> KEY_PASS_SHIFT);
+		if (b.offset >= 0) drawInstanced(pass, b);
+		else for (uint32_t i = b.first; i < b.first + b.count; i++) draw(pass, packets[entries[i].index]);
+	}
+	GLState::depthMask(GL_TRUE);
+
+	entries.clear();
+	packets.clear();
+}
+
+void RenderQueue::endFrame() {
+	if (!streaming) return;
+
+	instances.fence();
+	Profiler::counter("instance stalls", instances.getStalls());
+	streaming = false;
+}
+
+void RenderQueue::setup(RenderPass pass, const RenderPacket & packet) {
+	const ShaderProgram & shader = *packet.shader;
+	shader.use();
+	GLState::bindVertexArray(packet.vao);
+	if (packet.texture != 0) GLState::bindTexture(0, packet.textureTarget, packet.texture);
+	GLState::depthMask(pass == RENDER_PASS_SKYBOX ? GL_FALSE : GL_TRUE);
+	GLState::setEnabled(GL_CULL_FACE, packet.cullFace != GL_NONE);
+	if (packet.cullFace != GL_NONE) GLState::cullFace(packet.cullFace);
+
+	if (shader.get(UNIFORM_LAYER) >= 0) glUniform1i(shader.get(UNIFORM_LAYER), packet.layer);
+	if (shader.get(UNIFORM_PLANE_NORMAL) >= 0) glUniform3f(shader.get(UNIFORM_PLANE_NORMAL), packet.normal.x, packet.normal.y, packet.normal.z);
+	if (shader.get(UNIFORM_TEX_SCALE) >= 0) glUniform1f(shader.get(UNIFORM_TEX_SCALE), packet.texScale);
+}
+
+void RenderQueue::draw(RenderPass pass, const RenderPacket & packet) {
+	setup(pass, packet);
+
+	const ShaderProgram & shader = *packet.shader;
+	if (packet.instanced) {
+		//Spilled: the instance attributes as constants
+		for (int column = 0; column < 4; column++) {
+			glDisableVertexAttribArray(RENDER_INSTANCE_ATTRIB + column);
+			glVertexAttrib4fv(RENDER_INSTANCE_ATTRIB + column, &packet.model[column][0]);
+		}
+		glDisableVertexAttribArray(RENDER_INSTANCE_ATTRIB + 4);
+		glVertexAttrib3fv(RENDER_INSTANCE_ATTRIB + 4, &packet.rgb[0]);
+	}
+	else {
+		glUniformMatrix4fv(shader.get(UNIFORM_MODEL), 1, GL_FALSE, &packet.model[0][0]);
+		if (shader.get(UNIFORM_RGB) >= 0) glUniform3f(shader.get(UNIFORM_RGB), packet.rgb.x, packet.rgb.y, packet.rgb.z);
+	}
+
+	if (packet.indexed) glDrawElements(packet.mode, packet.count, GL_UNSIGNED_INT, 0);
+	else glDrawArrays(packet.mode, 0, packet.count);
+	Profiler::countDraw();
+}
+
+void RenderQueue::drawInstanced(RenderPass pass, const Batch & batch) {
+	const RenderPacket & packet = packets[entries[batch.first].index];
+	setup(pass, packet);
+
+	//No base instance before GL 4.2, so the mesh's VAO is pointed at this batch's instances instead
+	glBindBuffer(GL_ARRAY_BUFFER, instances.getBuffer());
+	for (int column = 0; column < 4; column++) {
+		GLuint attrib = RENDER_INSTANCE_ATTRIB + column;
+		glEnableVertexAttribArray(attrib);
+		glVertexAttribPointer(attrib, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), (GLvoid*)(batch.offset + offsetof(Instance, model) + column * sizeof(glm::vec4)));
+		glVertexAttribDivisor(attrib, 1);
+	}
+	GLuint attrib = RENDER_INSTANCE_ATTRIB + 4;
+	glEnableVertexAttribArray(attrib);
+	glVertexAttribPointer(attrib, 3, GL_FLOAT, GL_FALSE, sizeof(Instance), (GLvoid*)(batch.offset + offsetof(Instance, rgb)));
+	glVertexAttribDivisor(attrib, 1);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	if (packet.indexed) glDrawElementsInstanced(packet.mode, packet.count, GL_UNSIGNED_INT, 0, batch.count);
+	else glDrawArraysInstanced(packet.mode, 0, packet.count, batch.count);
+	Profiler::countDraw();
+}
@@ -0,0 +1,105 @@
+#pragma once
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <stdint.h>
+#include <vector>
+
+#include "ShaderProgram.h"
+#include "StreamBuffer.h"
+
+//Stages of a view, in the order they are drawn
+enum RenderPass {
+	RENDER_PASS_OPAQUE,		//grouped by state, front to back within each group
+	RENDER_PASS_SKYBOX,		//last, without depth writes: only the pixels nothing else covered are shaded
+	RENDER_PASSES
+};
+
+#define RENDER_DEPTH_FAR 100.0f		//view depth (meters) mapped to the largest sort key, anything farther ties
+#define RENDER_MAX_INSTANCES 32768	//per frame over all views, instanced packets past this are drawn one by one
+#define RENDER_INSTANCE_ATTRIB 3	//first vertex attribute of the instance data: model (4 columns), then rgb
+
+//One draw, with everything needed to issue it. Meshes fill these in (Model::submit, Quad::submit...),
+//uniforms a packet does not use are skipped when the program lacks them anyway.
+struct RenderPacket {
+	const ShaderProgram * shader = NULL;
+	GLuint vao = 0;
+	GLenum mode = GL_TRIANGLES;
+	GLsizei count = 0;
+	bool indexed = true;			//GL_UNSIGNED_INT elements from the VAO, else arrays from vertex 0
+	GLenum textureTarget = GL_TEXTURE_2D;
+	GLuint texture = 0;				//unit 0, none when 0
+	GLenum cullFace = GL_BACK;		//face culled, GL_NONE draws both sides
+	bool instanced = false;			//model and rgb as vertex attributes (from RENDER_INSTANCE_ATTRIB) instead of uniforms
+
+	glm::mat4 model = glm::mat4(1.0f);
+	glm::vec3 center = glm::vec3(0.0f);	//world space, for the depth order
+	glm::vec3 rgb = glm::vec3(1.0f);
+	GLint layer = 0;
+	glm::vec3 normal = glm::vec3(0.0f);
+	float texScale = 1.0f;
+};
+
+//Draws of one view, sorted before they are issued. Packets are keyed by
+//	pass (2 bits) | program (10) | texture (12) | VAO (12) | depth (24)
+//and radix sorted once per view, so draws sharing a program, texture and mesh end up next
+//to each other (GLState drops the repeated binds), and within them the nearest comes first.
+//Depth is the last field: the order is only front to back inside such a group, the groups
+//themselves follow the GL names. State changes and instanced batches come first here.
+//Serves the eye passes and the cave's off-axis wall passes alike; uniforms shared by a whole
+//view (wall projections, composite skybox) are set on the programs before flush(). An eye pass
+//is a single queue (the cave's wall quads, the hands and the skybox), so the skybox is only
+//shaded where neither covers it.
+//Instanced packets that end up next to each other with the same mesh, program and uniforms
+//are one instanced draw: their models and colors go to a StreamBuffer, in sorted order, so
+//the instances are still drawn front to back among themselves. Its region is fenced by endFrame().
+class RenderQueue {
+public:
+	static void initGl();
+	static void shutdownGl();
+
+	static void begin(const glm::mat4 & view, const glm::mat4 & projection);	//also sets the camera
+	static void submit(RenderPass pass, const RenderPacket & packet);
+	static void flush();	//sort, draw and empty the queue
+	static void endFrame();	//after the last flush of the frame
+
+private:
+	struct SortEntry {
+		uint64_t key;
+		uint32_t index;
+	};
+	//Sorted entries drawn together; offset of their instance data, -1 when drawn one by one
+	struct Batch {
+		uint32_t first;
+		uint32_t count;
+		GLintptr offset;
+	};
+	//Per-instance vertex attributes
+	struct Instance {
+		glm::mat4 model;
+		glm::vec3 rgb;
+	};
+
+	static glm::mat4 viewProjection;
+	static std::vector<RenderPacket> packets;
+	static std::vector<SortEntry> entries;
+	static std::vector<SortEntry> scratch;
+	static std::vector<Batch> batches;
+	static StreamBuffer instances;
+	static bool streaming;			//instances were written this frame
+	static unsigned int spilled;	//instanced packets drawn one by one for lack of space
+
+	static uint64_t makeKey(RenderPass pass, const RenderPacket & packet);
+	static void sort();
+	static void batch();
+	static void upload();
+	static bool sameBatch(const SortEntry & a, const SortEntry & b);
+	static void setup(RenderPass pass, const RenderPacket & packet);	//program, bindings and uniforms
+	static void draw(RenderPass pass, const RenderPacket & packet);
+	static void drawInstanced(RenderPass pass, const Batch & batch);
+};
+
+#endif
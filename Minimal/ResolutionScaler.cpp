@@ -0,0 +1,65 @@
+#include "ResolutionScaler.h"
+
+#include <algorithm>
+#include <cmath>
+
+ResolutionScaler::ResolutionScaler(float minDensity, float maxDensity, float budgetMs) : minDensity(std::min(minDensity, maxDensity)), maxDensity(maxDensity), budget(budgetMs) {
+	//Start at the display's native density where the limits allow it
+	density = std::min(std::max(1.0f, this->minDensity), maxDensity);
+}
+
+void ResolutionScaler::initGl() {
+	glGenQueries(RESOLUTION_TIMER_FRAMES * 2, queries[0]);
+}
+
+void ResolutionScaler::shutdownGl() {
+	glDeleteQueries(RESOLUTION_TIMER_FRAMES * 2, queries[0]);
+}
+
+void ResolutionScaler::beginFrame() {
+	//The slot about to be reused holds the oldest frame
+	resolve(frame);
+	glQueryCounter(queries[frame][0], GL_TIMESTAMP);
+}
+
+float ResolutionScaler::endFrame() {
+	glQueryCounter(queries[frame][1], GL_TIMESTAMP);
+	queryDensity[frame] = density;
+	pending[frame] = true;
+	frame = (frame + 1) % RESOLUTION_TIMER_FRAMES;
+	return density;
+}
+
+void ResolutionScaler::resolve(int slot) {
+	if (!pending[slot]) return;
+	pending[slot] = false;
+
+	GLint available = 0;
+	glGetQueryObjectiv(queries[slot][1], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available) return;
+
+	GLuint64 start, end;
+	glGetQueryObjectui64v(queries[slot][0], GL_QUERY_RESULT, &start);
+	glGetQueryObjectui64v(queries[slot][1], GL_QUERY_RESULT, &end);
+
+	//What that frame would have cost at the current density
+	float ratio = density / queryDensity[slot];
+	float sample = (float)((end - start) / 1000000.0) * ratio * ratio;
+	gpuTime = (gpuTime > 0.0f) ? gpuTime + (sample - gpuTime) * RESOLUTION_SMOOTHING : sample;
+
+	//Over budget: drop straight to the density that fits
+	if (sample > budget) {
+		setDensity(density * sqrtf(budget / sample));
+		return;
+	}
+	//Spare time: creep up towards the density that would just fit the headroom
+	float target = density * sqrtf(budget * RESOLUTION_RAISE_HEADROOM / gpuTime);
+	if (target > density) setDensity(std::min(target, density + RESOLUTION_MAX_RAISE));
+}
+
+void ResolutionScaler::setDensity(float d) {
+	d = std::min(std::max(d, minDensity), maxDensity);
+	float ratio = d / density;
+	gpuTime *= ratio * ratio;
+	density = d;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#ifndef RESOLUTION_SCALER_H
+#define RESOLUTION_SCALER_H
+
+#include <GL/glew.h>
+
+//Frames of timestamp pairs in flight. A frame's GPU time is read when its slot comes around
+//again; if the GPU still has not reached it the sample is dropped instead of waited for.
+#define RESOLUTION_TIMER_FRAMES 4
+#define RESOLUTION_DEFAULT_BUDGET 10.0f		//milliseconds of GPU per frame (90 Hz, less the compositor's share)
+#define RESOLUTION_SMOOTHING 0.1f			//weight of a new sample in the averaged GPU time
+#define RESOLUTION_RAISE_HEADROOM 0.85f		//density only rises while the averaged time stays below this share of the budget
+#define RESOLUTION_MAX_RAISE 0.01f			//largest density increase per frame
+
+//Picks the eye buffer pixel density from measured GPU frame time. GPU cost is taken as
+//proportional to the pixel count (density squared): a frame over budget drops the density
+//at once, while spare time only raises it slowly, so a spike costs resolution for a moment
+//instead of a missed frame the compositor has to reproject.
+class ResolutionScaler {
+public:
+	ResolutionScaler(float minDensity, float maxDensity, float budgetMs = RESOLUTION_DEFAULT_BUDGET);
+
+	void initGl();
+	void shutdownGl();
+
+	void beginFrame();	//before the first GPU work of the frame
+	float endFrame();	//after the frame is submitted, returns the density for the next frame
+
+	//Getters
+	float getDensity() { return density; }
+	float getGpuTime() { return gpuTime; }		//averaged, milliseconds at the current density
+	float getBudget() { return budget; }
+
+private:
+	float minDensity;
+	float maxDensity;
+	float budget;
+	float density;
+	float gpuTime = 0.0f;
+
+	GLuint queries[RESOLUTION_TIMER_FRAMES][2];
+	float queryDensity[RESOLUTION_TIMER_FRAMES] = { 0.0f };	//density the frame was rendered at
+	bool pending[RESOLUTION_TIMER_FRAMES] = { false };
+	int frame = 0;
+
+	void resolve(int slot);
+	void setDensity(float d);
+};
+
+#endif
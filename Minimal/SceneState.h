@@ -0,0 +1,36 @@
+#pragma once
+#ifndef SCENE_STATE_H
+#define SCENE_STATE_H
+
+#include <glm/glm.hpp>
+
+//Everything the simulation hands the renderer for one frame. Published by the simulation
+//thread and snapshotted once per frame by the render thread, so nothing in here may point
+//at state the simulation keeps changing.
+struct SceneState {
+	unsigned int frame = 0;		//render frame whose input this was simulated from
+	double time = 0.0;			//of the latest fixed step
+	float alpha = 0.0f;			//input time left over past the latest step, in steps (0 to 1): where to draw between the last two
+	float stepMs = 0.0f;		//CPU time spent simulating that input (its events and fixed steps, ObjectManager::update included)
+
+	//Moving state of the latest fixed step and of the one before, drawn in between (Simulation::getScene).
+	//The hands are not in here: they are tracking poses, drawn where the render thread last latched them.
+	glm::vec3 cubePosition = glm::vec3(0.0f);
+	glm::vec3 previousCubePosition = glm::vec3(0.0f);
+	glm::vec3 cubeScale = glm::vec3(1.0f);
+	glm::vec3 previousCubeScale = glm::vec3(1.0f);
+
+	//Cave
+	bool displayAsLCD = true;
+	bool analyticSkybox = true;
+	bool reprojection = true;
+	unsigned int renderModeCycles = 0;	//render mode presses so far (the cave's own benchmark also switches modes)
+
+	//Toggles read by the render loop
+	bool freezeCave = false;
+	bool headInHandL = false;
+	bool headInHandR = false;
+	bool debugLines = false;
+};
+
+#endif
@@ -0,0 +1,28 @@
+#include "ShaderProgram.h"
+
+//Names in the GLSL sources, in ShaderUniform order
+static const char * UNIFORM_NAMES[SHADER_UNIFORMS] = {
+	"model",
+	"rgb",
+	"texture_diffuse1",
+	"layer",
+	"planeNormal",
+	"texScale",
+	"skybox",
+	"analyticSkybox",
+	"skyboxExtent",
+	"wallProjections",
+	"wallMask"
+};
+
+ShaderProgram::ShaderProgram(GLuint program) : program(program) {
+	for (int i = 0; i < SHADER_UNIFORMS; i++) locations[i] = -1;
+	if (program == 0) return;
+
+	for (int i = 0; i < SHADER_UNIFORMS; i++) locations[i] = glGetUniformLocation(program, UNIFORM_NAMES[i]);
+
+	GLuint block = glGetUniformBlockIndex(program, "CaveEye");
+	if (block != GL_INVALID_INDEX) glUniformBlockBinding(program, block, CAVE_EYE_BINDING);
+	block = glGetUniformBlockIndex(program, "Camera");
+	if (block != GL_INVALID_INDEX) glUniformBlockBinding(program, block, CAMERA_BINDING);
+}
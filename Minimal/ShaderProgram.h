@@ -0,0 +1,47 @@
+#pragma once
+#ifndef SHADER_PROGRAM_H
+#define SHADER_PROGRAM_H
+
+#include <GL/glew.h>
+
+#include "GLState.h"
+
+//Uniform block binding points, shared by every program that declares the block
+#define CAVE_EYE_BINDING 0		//CaveEye: wall composite eye position and warps, per eye (Cave)
+#define CAMERA_BINDING 1		//Camera: view and projection of the current eye or wall pass (Shaders::setCamera)
+
+//Every uniform any of the programs uses. Locations are looked up once at link time;
+//one a program does not have stays -1, which glUniform* ignores.
+enum ShaderUniform {
+	UNIFORM_MODEL,
+	UNIFORM_RGB,
+	UNIFORM_TEXTURE,			//texture_diffuse1
+	UNIFORM_LAYER,
+	UNIFORM_PLANE_NORMAL,
+	UNIFORM_TEX_SCALE,
+	UNIFORM_SKYBOX,
+	UNIFORM_ANALYTIC_SKYBOX,
+	UNIFORM_SKYBOX_EXTENT,
+	UNIFORM_WALL_PROJECTIONS,
+	UNIFORM_WALL_MASK,
+	SHADER_UNIFORMS
+};
+
+//A linked program with its uniform locations resolved, and its uniform blocks bound
+//to the binding points above
+class ShaderProgram {
+public:
+	ShaderProgram(GLuint program = 0);
+
+	void use() const { GLState::useProgram(program); }
+
+	//Getters
+	GLuint getProgram() const { return program; }
+	GLint get(ShaderUniform uniform) const { return locations[uniform]; }
+
+private:
+	GLuint program;
+	GLint locations[SHADER_UNIFORMS];
+};
+
+#endif
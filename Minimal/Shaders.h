@@ -3,38 +3,84 @@
 #define SHADERS_H
 
 #include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "ShaderProgram.h"
 
 class Shaders{
 public:
-	//Setters
-	static void setColorShader(GLint s) {colorShader = s;}
-	static void setTextureShader(GLint s) { textureShader = s;}
-	static void setSkyboxShader(GLint s) { skyboxShader = s; }
-	static void setRenderedTextureShader(GLint s) { renderedTextureShader = s; }
-	static void setLCDisplayShader(GLint s) { LCDisplayShader = s; }
+	//Setters (program IDs from LoadShaders, their uniforms are resolved here)
+	static void setColorShader(GLuint s) { colorShader = ShaderProgram(s); }
+	static void setInstancedColorShader(GLuint s) { instancedColorShader = ShaderProgram(s); }
+	static void setTextureShader(GLuint s) { textureShader = ShaderProgram(s); }
+	static void setSkyboxShader(GLuint s) { skyboxShader = ShaderProgram(s); }
+	static void setRenderedTextureShader(GLuint s) { renderedTextureShader = ShaderProgram(s); }
+	static void setLCDisplayShader(GLuint s) { LCDisplayShader = ShaderProgram(s); }
+	static void setLayeredTextureShader(GLuint s) { layeredTextureShader = ShaderProgram(s); }
+	static void setLayeredSkyboxShader(GLuint s) { layeredSkyboxShader = ShaderProgram(s); }
 
 	//Getters
-	static GLint getColorShader() { return colorShader; }
-	static GLint getTextureShader() { return textureShader; }
-	static GLint getSkyboxShader() { return skyboxShader; }
-	static GLint getRenderedTextureShader() { return renderedTextureShader; }
-	static GLint getLCDisplayShader() { return LCDisplayShader; }
+	static const ShaderProgram & getColorShader() { return colorShader; }
+	static const ShaderProgram & getInstancedColorShader() { return instancedColorShader; }	//for instanced packets (Model)
+	static const ShaderProgram & getTextureShader() { return textureShader; }
+	static const ShaderProgram & getSkyboxShader() { return skyboxShader; }
+	static const ShaderProgram & getRenderedTextureShader() { return renderedTextureShader; }
+	static const ShaderProgram & getLCDisplayShader() { return LCDisplayShader; }
+	static const ShaderProgram & getLayeredTextureShader() { return layeredTextureShader; }
+	static const ShaderProgram & getLayeredSkyboxShader() { return layeredSkyboxShader; }
+
+	//Camera uniform block: written once per eye or wall pass, read by every program.
+	//Writing the camera that is already set does nothing.
+	static void initCamera() {
+		glGenBuffers(1, &cameraBuffer);
+		writeCamera();
+		glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_BINDING, cameraBuffer);	//stays bound, orphaning keeps the buffer name
+	}
+	static void setCamera(const glm::mat4 & view, const glm::mat4 & projection) {
+		if (view == camera.view && projection == camera.projection) return;
+		camera.view = view;
+		camera.projection = projection;
+		writeCamera();
+	}
 
 	//delete shaders
 	static void deleteShaders(){
-		glDeleteProgram(colorShader);
-		glDeleteProgram(textureShader);
-		glDeleteProgram(skyboxShader);
-		glDeleteProgram(renderedTextureShader);
-		glDeleteProgram(LCDisplayShader);
+		glDeleteProgram(colorShader.getProgram());
+		glDeleteProgram(instancedColorShader.getProgram());
+		glDeleteProgram(textureShader.getProgram());
+		glDeleteProgram(skyboxShader.getProgram());
+		glDeleteProgram(renderedTextureShader.getProgram());
+		glDeleteProgram(LCDisplayShader.getProgram());
+		glDeleteProgram(layeredTextureShader.getProgram());
+		glDeleteProgram(layeredSkyboxShader.getProgram());
+		glDeleteBuffers(1, &cameraBuffer);
+		cameraBuffer = 0;
 	}
 
 protected:
-	static GLint colorShader; 
-	static GLint textureShader;
-	static GLint skyboxShader;
-	static GLint renderedTextureShader;
-	static GLint LCDisplayShader;
+	//std140 layout of the Camera uniform block
+	struct CameraBlock {
+		glm::mat4 view = glm::mat4(1.0f);
+		glm::mat4 projection = glm::mat4(1.0f);
+	};
+
+	static ShaderProgram colorShader; 
+	static ShaderProgram instancedColorShader;
+	static ShaderProgram textureShader;
+	static ShaderProgram skyboxShader;
+	static ShaderProgram renderedTextureShader;
+	static ShaderProgram LCDisplayShader;
+	static ShaderProgram layeredTextureShader;
+	static ShaderProgram layeredSkyboxShader;
+	static GLuint cameraBuffer;
+	static CameraBlock camera;
+
+	static void writeCamera() {
+		//Orphaned on every write, so updating it never waits on a pass still reading the old contents
+		glBindBuffer(GL_UNIFORM_BUFFER, cameraBuffer);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraBlock), &camera, GL_STREAM_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,111 @@
+#include "SimulatedBackend.h"
+#include "Definitions.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+
+//Clip planes (same as the Rift projection)
+#define SIM_NEAR_PLANE 0.01f
+#define SIM_FAR_PLANE 1000.0f
+
+//Synthetic motion
+#define SIM_WALK_RADIUS 0.3f		//meters
+#define SIM_WALK_SPEED 0.8f			//meters per second
+#define SIM_WALK_BOB 0.02f			//vertical head bob (meters)
+#define SIM_LOOK_YAW 60.0f			//degrees either side
+#define SIM_LOOK_PITCH 20.0f		//degrees up and down
+#define SIM_HAND_OFFSET glm::vec3(0.2f, -0.3f, -0.35f)	//right hand from the head (mirrored for the left)
+
+SimulatedBackend::SimulatedBackend(const SimulatedHmdDesc & desc) : desc(desc) {
+	//Both eyes side by side in one target, like the Rift swap chain
+	maxPixelDensity = pixelDensity = desc.maxPixelDensity;
+	glm::uvec2 eyeSize = glm::uvec2((unsigned int)(desc.eyeSize.x * maxPixelDensity), (unsigned int)(desc.eyeSize.y * maxPixelDensity));
+	for (int eye = 0; eye < 2; eye++) {
+		glm::vec4 fov = desc.fov[eye];
+		projections[eye] = glm::frustum(-fov.x * SIM_NEAR_PLANE, fov.y * SIM_NEAR_PLANE, -fov.w * SIM_NEAR_PLANE, fov.z * SIM_NEAR_PLANE, SIM_NEAR_PLANE, SIM_FAR_PLANE);
+		viewports[eye] = fullViewports[eye] = glm::ivec4(eye * eyeSize.x, 0, eyeSize.x, eyeSize.y);
+	}
+	renderTargetSize = glm::uvec2(eyeSize.x * 2, eyeSize.y);
+
+	// Make the on screen window 1/4 the native resolution of the render target
+	mirrorSize = glm::uvec2(desc.eyeSize.x * 2, desc.eyeSize.y);
+	mirrorSize /= 4;
+}
+
+SimulatedBackend::~SimulatedBackend() { }
+
+void SimulatedBackend::initGl() {
+	//Offscreen target in place of the swap chain
+	glGenTextures(1, &eyeTexture);
+	glBindTexture(GL_TEXTURE_2D, eyeTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, renderTargetSize.x, renderTargetSize.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenFramebuffers(1, &mirrorFbo);
+}
+
+void SimulatedBackend::shutdownGl() {
+	glDeleteFramebuffers(1, &mirrorFbo);
+	glDeleteTextures(1, &eyeTexture);
+}
+
+HmdFrame SimulatedBackend::beginFrame(unsigned int frame) {
+	HmdFrame result;
+	time = frame / desc.frameRate;
+
+	glm::mat4 head = getHeadPose(time);
+
+	//Eyes half the IPD either side of the head
+	result.eyePoses[0] = glm::translate(head, glm::vec3(-desc.ipd * 0.5f, 0, 0));
+	result.eyePoses[1] = glm::translate(head, glm::vec3(desc.ipd * 0.5f, 0, 0));
+
+	//Hands held in front, following the head
+	glm::vec3 hand = SIM_HAND_OFFSET;
+	result.handPoses[0] = glm::translate(head, glm::vec3(-hand.x, hand.y, hand.z));
+	result.handPoses[1] = glm::translate(head, hand);
+
+	return result;
+}
+
+glm::mat4 SimulatedBackend::getHeadPose(double t) {
+	glm::mat4 pose = glm::mat4(1.0f);
+	float yaw = 0.0f;
+	float pitch = 0.0f;
+
+	switch (desc.motion) {
+	case SIM_MOTION_WALK: {
+		float angle = (float)(t * SIM_WALK_SPEED / SIM_WALK_RADIUS);
+		float bob = SIM_WALK_BOB * std::sin(angle * 4.0f);
+		pose = glm::translate(pose, glm::vec3(SIM_WALK_RADIUS * std::sin(angle), bob, SIM_WALK_RADIUS * std::cos(angle)));
+		yaw = angle - MATH_PI * 0.5f;
+		break;
+	}
+	case SIM_MOTION_LOOK:
+		yaw = glm::radians(SIM_LOOK_YAW) * std::sin((float)t * MATH_PI * 0.5f);
+		pitch = glm::radians(SIM_LOOK_PITCH) * std::sin((float)t * MATH_PI * 0.2f);
+		break;
+	default:
+		break;
+	}
+
+	pose = glm::rotate(pose, yaw, glm::vec3(0, 1, 0));
+	pose = glm::rotate(pose, pitch, glm::vec3(1, 0, 0));
+	return pose;
+}
+
+void SimulatedBackend::blitMirror(glm::uvec2 windowSize) {
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, mirrorFbo);
+	glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, eyeTexture, 0);
+	//Each eye's rendered viewport into its half of the window (upsampled like the compositor would)
+	for (int eye = 0; eye < 2; eye++) {
+		glm::ivec4 vp = viewports[eye];
+		GLint x0 = eye * windowSize.x / 2, x1 = (eye + 1) * windowSize.x / 2;
+		glBlitFramebuffer(vp.x, vp.y, vp.x + vp.z, vp.y + vp.w, x0, 0, x1, windowSize.y, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+	}
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
@@ -0,0 +1,49 @@
+#pragma once
+#ifndef SIMULATED_BACKEND_H
+#define SIMULATED_BACKEND_H
+
+#include "HmdBackend.h"
+
+//Head motion of the simulated HMD
+enum SimulatedMotion {
+	SIM_MOTION_STATIC,	//standing still in the middle of the CAVE
+	SIM_MOTION_WALK,	//walking a small circle, facing along the path
+	SIM_MOTION_LOOK		//standing still, looking around
+};
+
+//Everything the simulated HMD reports, Rift CV1-like by default
+struct SimulatedHmdDesc {
+	glm::uvec2 eyeSize = glm::uvec2(1344, 1600);	//render target size of one eye at native pixel density
+	float maxPixelDensity = 1.0f;	//the target is allocated at this density, for dynamic resolution to scale within
+	glm::vec4 fov[2] = { glm::vec4(1.0f), glm::vec4(1.0f) };	//tangents of the left, right, up and down half angles
+	float ipd = 0.064f;
+	double frameRate = 90.0;	//the simulated clock advances 1 / frameRate per frame
+	SimulatedMotion motion = SIM_MOTION_STATIC;
+};
+
+//Display without a headset: eyes render into an offscreen texture, poses come from a
+//synthetic motion and time from a fixed-step clock, so runs are repeatable at full speed.
+class SimulatedBackend : public HmdBackend {
+public:
+	SimulatedBackend(const SimulatedHmdDesc & desc);
+	~SimulatedBackend();
+
+	void initGl() override;
+	void shutdownGl() override;
+
+	HmdFrame beginFrame(unsigned int frame) override;
+	GLuint getEyeTexture() override { return eyeTexture; }
+	void submitFrame(unsigned int frame) override { }
+	void blitMirror(glm::uvec2 windowSize) override;
+	double getTime() override { return time; }
+
+private:
+	SimulatedHmdDesc desc;
+	GLuint eyeTexture = 0;
+	GLuint mirrorFbo = 0;
+	double time = 0.0;
+
+	glm::mat4 getHeadPose(double t);
+};
+
+#endif
@@ -0,0 +1,145 @@
+#include "Simulation.h"
+#include "Definitions.h"
+#include "ObjectManager.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+
+//Scene at rest: the previous step equals the current one
+static SceneState settle(SceneState scene) {
+	scene.previousCubePosition = scene.cubePosition;
+	scene.previousCubeScale = scene.cubeScale;
+	return scene;
+}
+
+Simulation::Simulation(ObjectManager * objects, InputSampler * input, const SceneState & initial) : objects(objects), input(input), initial(settle(initial)), state(settle(initial)), scenes(settle(initial)) { }
+
+Simulation::~Simulation() {
+	stop();
+}
+
+void Simulation::start() {
+	if (running.exchange(true)) return;
+	thread = std::thread(&Simulation::run, this);
+}
+
+void Simulation::stop() {
+	if (!running.exchange(false)) return;
+	thread.join();
+}
+
+//==============================================================================RENDER THREAD
+void Simulation::submit(const SimulationInput & in) {
+	inputs.getWriteBuffer() = in;
+	inputs.publish();
+}
+
+SceneState Simulation::getScene() {
+	//The Profiler is not thread-safe, so the simulation's own timing is reported from here, once per new state
+	bool fresh = scenes.update();
+	SceneState scene = scenes.getReadBuffer();
+	if (fresh) Profiler::counter("simulation step ms", scene.stepMs);
+
+	//One step behind the input: between the last two steps, by the time the input reached past the latest
+	scene.cubePosition = glm::mix(scene.previousCubePosition, scene.cubePosition, scene.alpha);
+	scene.cubeScale = glm::mix(scene.previousCubeScale, scene.cubeScale, scene.alpha);
+	return scene;
+}
+
+//==============================================================================SIMULATION THREAD
+void Simulation::run() {
+	while (running.load()) {
+		if (!inputs.update()) {
+			std::this_thread::sleep_for(std::chrono::microseconds(SIM_IDLE_SLEEP_US));
+			continue;
+		}
+		step(inputs.getReadBuffer());
+	}
+}
+
+void Simulation::step(const SimulationInput & in) {
+	auto start = std::chrono::steady_clock::now();
+	if (lastTime < 0.0) lastTime = in.time;
+
+	//Consume the input's time in fixed steps; after a stall only SIM_MAX_STEPS are caught up
+	accumulator = std::min(accumulator + in.time - lastTime, SIM_MAX_STEPS * SIM_STEP);
+	lastTime = in.time;
+	while (accumulator >= SIM_STEP) {
+		applyEvents(in.time - accumulator + SIM_STEP);
+		fixedStep(SIM_STEP);
+		accumulator -= SIM_STEP;
+	}
+
+	//Publish
+	SceneState & out = scenes.getWriteBuffer();
+	out = state;
+	out.frame = in.frame;
+	out.time = in.time - accumulator;
+	out.alpha = (float)(accumulator / SIM_STEP);
+	out.stepMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+	scenes.publish();
+}
+
+void Simulation::fixedStep(double deltaTime) {
+	//The step about to be replaced becomes the one the renderer interpolates from
+	state.previousCubePosition = state.cubePosition;
+	state.previousCubeScale = state.cubeScale;
+
+	//Sticks move and scale the cube at a fixed rate per second
+	float dt = (float)deltaTime;
+	glm::vec2 stickL = Input::getStickL();
+	glm::vec2 stickR = Input::getStickR();
+	state.cubePosition += glm::vec3(stickL.x, stickR.y, -stickL.y) * (SIM_CUBE_SPEED * dt);
+	state.cubeScale = glm::vec3(state.cubeScale.x + stickR.x * SIM_CUBE_GROWTH * dt);
+
+	//Calls update in children
+	objects->update(deltaTime);
+}
+
+void Simulation::applyEvents(double until) {
+	//Input is only touched from this thread
+	InputEvent e;
+	while (input->poll(e, until)) handleEvent(e);
+
+	//Held buttons
+	state.headInHandL = Input::getIndexTriggerL();
+	state.headInHandR = Input::getIndexTriggerR();
+	state.debugLines = Input::getButtonA();
+}
+
+void Simulation::handleEvent(const InputEvent & e) {
+	Input::apply(e);
+	if (e.type != INPUT_PRESS) return;
+
+	switch (e.control) {
+	//Hand Trigger - Right
+	case INPUT_HAND_TRIGGER_R:
+		state.analyticSkybox = !state.analyticSkybox;
+		break;
+	//Hand Trigger - Left
+	case INPUT_HAND_TRIGGER_L:
+		state.reprojection = !state.reprojection;
+		break;
+	//Button X
+	case INPUT_BUTTON_X:
+		state.displayAsLCD = !state.displayAsLCD;
+		break;
+	//Button Y
+	case INPUT_BUTTON_Y:
+		state.renderModeCycles++;
+		break;
+	//Button B
+	case INPUT_BUTTON_B:
+		state.freezeCave = !state.freezeCave;
+		break;
+	//Button LS
+	case INPUT_BUTTON_STICK_L:
+		state.cubePosition = state.previousCubePosition = initial.cubePosition;
+		break;
+	//Button RS
+	case INPUT_BUTTON_STICK_R:
+		state.cubeScale = state.previousCubeScale = initial.cubeScale;
+		break;
+	}
+}
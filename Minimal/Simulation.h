@@ -0,0 +1,71 @@
+#pragma once
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <thread>
+
+#include "InputSampler.h"
+#include "SceneState.h"
+#include "TripleBuffer.h"
+
+#define SIM_IDLE_SLEEP_US 250	//wait between checks for new input (microseconds)
+
+//Fixed timestep: every update advances exactly SIM_STEP, independent of the frame rate
+#define SIM_RATE 500.0
+#define SIM_STEP (1.0 / SIM_RATE)
+#define SIM_MAX_STEPS 25		//catch-up bound per input; time beyond this after a stall is dropped
+
+//Stick speeds at full deflection (0.01 per frame at 90 Hz, as before they were time-scaled)
+#define SIM_CUBE_SPEED 0.9f		//meters per second
+#define SIM_CUBE_GROWTH 0.9f	//scale per second
+
+class ObjectManager;
+
+//What the render thread sampled for a frame, handed to the simulation (controller events come through the InputSampler)
+struct SimulationInput {
+	unsigned int frame = 0;
+	double time = 0.0;
+};
+
+//Controller handling and object updates on their own thread. The render thread submits
+//each frame's input and snapshots the newest scene; both go through triple buffers, so
+//neither thread ever waits on the other and interaction logic costs no render time.
+//Input time is consumed in fixed steps; the renderer draws between the last two, by the input
+//time left over past the latest (so one step behind the input, whenever it gets to draw it).
+//Controller events are applied at the first step that reaches their sample time.
+class Simulation {
+public:
+	Simulation(ObjectManager * objects, InputSampler * input, const SceneState & initial);
+	~Simulation();
+
+	void start();
+	void stop();
+
+	//Render thread
+	void submit(const SimulationInput & in);
+	SceneState getScene();	//newest scene, interpolated by its leftover time (also reports its step time to the Profiler)
+
+private:
+	ObjectManager * objects;
+	InputSampler * input;
+	SceneState initial;		//reset targets
+	SceneState state;		//simulation thread only
+	double lastTime = -1.0;		//input time consumed so far
+	double accumulator = 0.0;	//input time not yet stepped
+
+	TripleBuffer<SimulationInput> inputs;
+	TripleBuffer<SceneState> scenes;
+	std::thread thread;
+	std::atomic<bool> running{ false };
+
+	void run();
+	void step(const SimulationInput & in);
+	void fixedStep(double deltaTime);
+	void applyEvents(double until);
+	void handleEvent(const InputEvent & e);
+};
+
+#endif
@@ -13,7 +13,7 @@ Skybox::Skybox(std::string path){
 				path + "/front.ppm"		//front		//nz
 			};
 
-	initVertices(10.0f);	//parameter is the distance from the center
+	initVertices(SKYBOX_EXTENT);	//parameter is the distance from the center
 	initCubeMap();
 	loadCubeMap(faces);		
 }
@@ -27,26 +27,19 @@ void Skybox::setPos(glm::vec3 pos) {
 	toWorld[3] = glm::vec4(pos.x, pos.y, pos.z, 1.0f);
 }
 
-void Skybox::draw(glm::mat4 projection, glm::mat4 headPose, GLint shader) {
-	glActiveTexture(GL_TEXTURE0);
-	glDepthMask(GL_FALSE);
-	glUseProgram(shader);
-
-	glUniformMatrix4fv(glGetUniformLocation(shader, "projection"), 1, GL_FALSE, &projection[0][0]);
-	glUniformMatrix4fv(glGetUniformLocation(shader, "view"), 1, GL_FALSE, &headPose[0][0]);
-	glUniformMatrix4fv(glGetUniformLocation(shader, "model"), 1, GL_FALSE, &toWorld[0][0]);
-
-	glBindVertexArray(VAO);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glDrawArrays(GL_TRIANGLES, 0, 36);
-	glDepthMask(GL_TRUE);
-
-	//glEnable(GL_CULL_FACE);
-	//glCullFace(GL_BACK);
+void Skybox::submit(const ShaderProgram & shader) {
+	//Sampling parameters are part of the texture, set once in loadCubeMap()
+	RenderPacket packet;
+	packet.shader = &shader;
+	packet.vao = VAO;
+	packet.indexed = false;
+	packet.count = 36;
+	packet.textureTarget = GL_TEXTURE_CUBE_MAP;
+	packet.texture = textureID;
+	packet.cullFace = GL_NONE;	//seen from inside
+	packet.model = toWorld;
+	packet.center = glm::vec3(toWorld[3]);
+	RenderQueue::submit(RENDER_PASS_SKYBOX, packet);
 }
 
 void Skybox::loadCubeMap(std::vector<std::string> faces) {
@@ -67,12 +60,13 @@ void Skybox::loadCubeMap(std::vector<std::string> faces) {
 		}
 		stbi_image_free(data);
 	}
-	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+	//Set while the cubemap is bound; after the unbind they applied to no texture at all
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
 }
 
 void Skybox::initVertices(float p) {
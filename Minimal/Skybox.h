@@ -18,12 +18,17 @@
 #include <vector>
 #include <float.h>
 
+#include "RenderQueue.h"
+
+//Half size of the skybox cube around its center
+#define SKYBOX_EXTENT 10.0f
+
 class Skybox{
 public:
 	Skybox(std::string path);
 	~Skybox();
 	unsigned int getTextureID();
-	void draw(glm::mat4 projection, glm::mat4 headPose, GLint shader);
+	void submit(const ShaderProgram & shader);	//to the RenderQueue, drawn after everything opaque
 
 	void setPos(glm::vec3 pos);
 
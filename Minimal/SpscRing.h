@@ -0,0 +1,43 @@
+#pragma once
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+
+//Lock-free queue from one producer thread to one consumer thread. Fixed capacity (a power
+//of two); a push to a full ring fails rather than waiting, so the producer never blocks.
+template <typename T, unsigned int N>
+class SpscRing {
+	static_assert(N > 0 && (N & (N - 1)) == 0, "SpscRing capacity must be a power of two");
+
+public:
+	//Producer
+	bool push(const T & value) {
+		unsigned int h = head.load(std::memory_order_relaxed);
+		if (h - tail.load(std::memory_order_acquire) == N) return false;
+		buffer[h & (N - 1)] = value;
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	//Consumer: peek() looks at the oldest value without taking it, pop() takes it
+	bool peek(T & value) const {
+		unsigned int t = tail.load(std::memory_order_relaxed);
+		if (t == head.load(std::memory_order_acquire)) return false;
+		value = buffer[t & (N - 1)];
+		return true;
+	}
+	void pop() { tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+	bool pop(T & value) {
+		if (!peek(value)) return false;
+		pop();
+		return true;
+	}
+
+private:
+	T buffer[N];
+	std::atomic<unsigned int> head{ 0 };	//next slot the producer writes
+	std::atomic<unsigned int> tail{ 0 };	//next slot the consumer reads
+};
+
+#endif
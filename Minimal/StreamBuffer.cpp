@@ -0,0 +1,104 @@
+#include "StreamBuffer.h"
+
+#include <iostream>
+
+StreamBuffer::StreamBuffer(GLenum target, GLsizeiptr regionSize) : target(target), regionSize(regionSize) { }
+
+void StreamBuffer::initGl() {
+	glGenBuffers(1, &buffer);
+	glBindBuffer(target, buffer);
+
+	persistent = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+	if (persistent) {
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(target, regionSize * STREAM_REGIONS, NULL, flags);
+		mapped = (char *)glMapBufferRange(target, 0, regionSize * STREAM_REGIONS, flags);
+		if (mapped == NULL) {
+			std::cerr << "Unable to map stream buffer persistently" << std::endl;
+			//Immutable storage cannot be respecified, start over with a mutable one
+			glBindBuffer(target, 0);
+			glDeleteBuffers(1, &buffer);
+			glGenBuffers(1, &buffer);
+			glBindBuffer(target, buffer);
+			persistent = false;
+		}
+	}
+	if (!persistent) glBufferData(target, regionSize * STREAM_REGIONS, NULL, GL_STREAM_DRAW);
+
+	glBindBuffer(target, 0);
+}
+
+void StreamBuffer::shutdownGl() {
+	for (int i = 0; i < STREAM_REGIONS; i++) {
+		if (fences[i]) glDeleteSync(fences[i]);
+		fences[i] = NULL;
+	}
+	if (mapped) {
+		glBindBuffer(target, buffer);
+		glUnmapBuffer(target);
+		glBindBuffer(target, 0);
+		mapped = NULL;
+	}
+	glDeleteBuffers(1, &buffer);
+	buffer = 0;
+}
+
+void StreamBuffer::begin() {
+	region = (region + 1) % STREAM_REGIONS;
+	used = 0;
+
+	//The GPU is normally frames past this region; waiting here means it fell behind
+	GLsync & f = fences[region];
+	if (f) {
+		GLenum result = glClientWaitSync(f, 0, 0);
+		if (result == GL_TIMEOUT_EXPIRED) {
+			stalls++;
+			do result = glClientWaitSync(f, GL_SYNC_FLUSH_COMMANDS_BIT, STREAM_FENCE_TIMEOUT);
+			while (result == GL_TIMEOUT_EXPIRED);
+		}
+		glDeleteSync(f);
+		f = NULL;
+	}
+
+	map();
+}
+
+void StreamBuffer::resume() {
+	//Draws already issued read the part before used, which is neither waited for nor touched
+	map();
+}
+
+void StreamBuffer::map() {
+	if (persistent) return;
+	mapped = NULL;
+	mappedFrom = used;
+	if (used >= regionSize) return;
+	glBindBuffer(target, buffer);
+	mapped = (char *)glMapBufferRange(target, region * regionSize + used, regionSize - used,
+		GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_FLUSH_EXPLICIT_BIT);
+	glBindBuffer(target, 0);
+}
+
+void * StreamBuffer::allocate(GLsizeiptr size, GLintptr & offset) {
+	if (mapped == NULL || used + size > regionSize) return NULL;
+
+	offset = region * regionSize + used;
+	char * data = persistent ? mapped + offset : mapped + (used - mappedFrom);
+	used += size;
+	return data;
+}
+
+void StreamBuffer::end() {
+	//Coherent mapping: writes are visible to the next draw as they are
+	if (persistent || mapped == NULL) return;
+	glBindBuffer(target, buffer);
+	if (used > mappedFrom) glFlushMappedBufferRange(target, 0, used - mappedFrom);
+	glUnmapBuffer(target);
+	glBindBuffer(target, 0);
+	mapped = NULL;
+}
+
+void StreamBuffer::fence() {
+	if (fences[region]) glDeleteSync(fences[region]);
+	fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
@@ -0,0 +1,52 @@
+#pragma once
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <GL/glew.h>
+
+//Regions of the ring: the CPU writes one while the GPU may still read the ones before it
+#define STREAM_REGIONS 3
+#define STREAM_FENCE_TIMEOUT 1000000	//nanoseconds per wait before it is retried
+
+//Per-frame vertex data without a buffer allocation or a driver copy per draw. One buffer
+//holds STREAM_REGIONS regions used in turn; each region gets a fence after the last draw
+//reading it, and is only written again once that fence has signaled.
+//With ARB_buffer_storage (GL 4.4) the buffer is mapped once, persistently and coherently.
+//On a plain 4.1 context each region is mapped unsynchronized instead, the fences make that safe.
+class StreamBuffer {
+public:
+	StreamBuffer(GLenum target, GLsizeiptr regionSize);
+
+	void initGl();
+	void shutdownGl();
+
+	//One region per frame: begin() waits for it to be free, allocate() hands out space in it,
+	//end() makes the writes visible, fence() follows the last draw that reads them
+	void begin();
+	void resume();	//more writes to the region after end(), for a frame that uploads between its draws
+	void * allocate(GLsizeiptr size, GLintptr & offset);	//NULL once the region is full; offset into the whole buffer
+	void end();
+	void fence();
+
+	//Getters
+	GLuint getBuffer() { return buffer; }
+	bool isPersistent() { return persistent; }
+	unsigned int getStalls() { return stalls; }		//begin() calls that had to wait for the GPU
+
+private:
+	GLenum target;
+	GLsizeiptr regionSize;
+	GLuint buffer = 0;
+	bool persistent = false;
+
+	char * mapped = NULL;			//whole buffer when persistent, else the current region while it is mapped
+	GLsizeiptr mappedFrom = 0;		//where in the region that mapping starts
+	GLsync fences[STREAM_REGIONS] = { NULL };
+	int region = STREAM_REGIONS - 1;
+	GLsizeiptr used = 0;
+	unsigned int stalls = 0;
+
+	void map();		//rest of the current region, unsynchronized
+};
+
+#endif
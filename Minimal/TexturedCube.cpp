@@ -31,23 +31,15 @@ void TexturedCube::setScale(float scale) {
 	toWorld = glm::scale(toWorld, glm::vec3(scale, scale, scale));
 }
 
-void TexturedCube::draw(glm::mat4 projection, glm::mat4 headPose, GLint shader, glm::mat4 M){
-	glm::mat4 m = M * toWorld;
-
-	glUseProgram(shader);
-
-	glUniform1i(glGetUniformLocation(shader, "TexCoords"), 0);
-	glUniformMatrix4fv(glGetUniformLocation(shader, "projection"), 1, GL_FALSE, &projection[0][0]);
-	glUniformMatrix4fv(glGetUniformLocation(shader, "view"), 1, GL_FALSE, &headPose[0][0]);
-	glUniformMatrix4fv(glGetUniformLocation(shader, "model"), 1, GL_FALSE, &m[0][0]);
-
-	glBindVertexArray(VAO);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, TEX);
-	glDrawElements(GL_TRIANGLES, (GLsizei)indices.size(), GL_UNSIGNED_INT, 0);
-	
-
-	glBindVertexArray(0);
+void TexturedCube::submit(const ShaderProgram & shader, glm::mat4 M){
+	RenderPacket packet;
+	packet.shader = &shader;
+	packet.vao = VAO;
+	packet.count = (GLsizei)indices.size();
+	packet.texture = TEX;
+	packet.model = M * toWorld;
+	packet.center = glm::vec3(packet.model[3]);
+	RenderQueue::submit(RENDER_PASS_OPAQUE, packet);
 }
 
 void TexturedCube::update() {
@@ -13,6 +13,8 @@
 #include <string>
 #include <vector>
 
+#include "RenderQueue.h"
+
 class TexturedCube{
 public:
 	TexturedCube(const char * tex);
@@ -20,7 +22,7 @@ public:
 
 	glm::mat4 toWorld;
 
-	void draw(glm::mat4 projection, glm::mat4 headPose, GLint shader, glm::mat4 M);
+	void submit(const ShaderProgram & shader, glm::mat4 M);	//to the RenderQueue
 	void update();
 
 	void setPosition(glm::vec3 pos);
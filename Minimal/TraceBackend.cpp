@@ -0,0 +1,66 @@
+#include "TraceBackend.h"
+
+TraceBackend::TraceBackend(HmdBackend * display, const char * path, TraceMode mode) : display(display), mode(mode) {
+	//Same target and lenses as the wrapped display
+	renderTargetSize = display->getRenderTargetSize();
+	mirrorSize = display->getMirrorSize();
+	maxPixelDensity = display->getMaxPixelDensity();
+	pixelDensity = display->getPixelDensity();
+	for (int eye = 0; eye < 2; eye++) {
+		viewports[eye] = fullViewports[eye] = display->getViewport(eye);
+		projections[eye] = display->getProjection(eye);
+	}
+
+	if (mode == TRACE_RECORD) writer = new PoseTraceWriter(path);
+	else reader = new PoseTraceReader(path);
+}
+
+TraceBackend::~TraceBackend() {
+	delete(writer);
+	delete(reader);
+	delete(display);
+}
+
+HmdFrame TraceBackend::beginFrame(unsigned int frame) {
+	//The display still runs its frame (the Rift needs its poses fetched before submitting)
+	HmdFrame live = display->beginFrame(frame);
+
+	if (mode == TRACE_RECORD) {
+		time = display->getTime();
+		recorded = live;
+		for (int latch = 0; latch < POSE_TRACE_LATCHES; latch++) latched[latch] = live;
+		pending = true;
+		return live;
+	}
+
+	pending = !isFinished();
+	if (!pending) return live;
+	return reader->read(replayed++, time);
+}
+
+void TraceBackend::latchPoses(unsigned int frame, HmdFrame & poses, int eye) {
+	if (mode == TRACE_RECORD) {
+		display->latchPoses(frame, poses, eye);
+		latched[poseTraceLatch(eye)] = poses;
+		return;
+	}
+	//The poses this latch returned when the frame was recorded
+	if (pending) reader->readLatch(replayed - 1, eye, poses);
+}
+
+void TraceBackend::submitFrame(unsigned int frame) {
+	if (pending && mode == TRACE_RECORD) writer->write(recorded, latched, time);
+	pending = false;
+	display->submitFrame(frame);
+}
+
+bool TraceBackend::isFinished() {
+	return mode == TRACE_REPLAY && (!reader->isOpen() || replayed >= reader->getFrameCount());
+}
+
+void TraceBackend::setPixelDensity(float density) {
+	//The display owns the target (and, on the Rift, the layer viewports)
+	display->setPixelDensity(density);
+	pixelDensity = display->getPixelDensity();
+	for (int eye = 0; eye < 2; eye++) viewports[eye] = display->getViewport(eye);
+}
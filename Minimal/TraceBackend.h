@@ -0,0 +1,48 @@
+#pragma once
+#ifndef TRACE_BACKEND_H
+#define TRACE_BACKEND_H
+
+#include "HmdBackend.h"
+#include "PoseTrace.h"
+
+enum TraceMode {
+	TRACE_RECORD,	//pass the display's poses and input through, writing each frame to the trace
+	TRACE_REPLAY	//ignore the display's poses and input, feed the trace instead
+};
+
+//Wraps a display backend to record or replay its per-frame poses, input and clock.
+//Rendering still goes to the wrapped display, so a trace recorded on the Rift can be
+//replayed on the simulated HMD and every run sees identical head motion. The poses of
+//every late latch are kept too, and a frame is only written once submitted, so a replay
+//renders with the same poses the recorded frame was rendered with.
+class TraceBackend : public HmdBackend {
+public:
+	TraceBackend(HmdBackend * display, const char * path, TraceMode mode);
+	~TraceBackend();
+
+	void initGl() override { display->initGl(); }
+	void shutdownGl() override { display->shutdownGl(); }
+
+	HmdFrame beginFrame(unsigned int frame) override;
+	void latchPoses(unsigned int frame, HmdFrame & poses, int eye = -1) override;
+	GLuint getEyeTexture() override { return display->getEyeTexture(); }
+	void submitFrame(unsigned int frame) override;
+	void blitMirror(glm::uvec2 windowSize) override { display->blitMirror(windowSize); }
+	void recenter() override { display->recenter(); }
+	void setPixelDensity(float density) override;
+	double getTime() override { return time; }
+	bool isFinished() override;
+
+private:
+	HmdBackend * display;
+	TraceMode mode;
+	PoseTraceWriter * writer = NULL;
+	PoseTraceReader * reader = NULL;
+	unsigned int replayed = 0;		//frames fed from the trace so far
+	HmdFrame recorded;				//frame being recorded, written on submit
+	HmdFrame latched[POSE_TRACE_LATCHES];
+	bool pending = false;			//a frame to or from the trace is between beginFrame() and submitFrame()
+	double time = 0.0;
+};
+
+#endif
@@ -5,20 +5,24 @@
 
 #include "Definitions.h"
 #include "Model.h"
+#include "ShaderProgram.h"
 #include "Component.h"
 #include <vector>
 
 class Transform {
 public:
-	Transform(Model * model = NULL, GLint shader = 0, glm::vec3 color = glm::vec3(COLOR_WHITE));
+	//The model is shared with other transforms and not owned
+	Transform(Model * model = NULL, const ShaderProgram * shader = NULL, glm::vec3 color = glm::vec3(COLOR_WHITE));
 	~Transform();
 
-	void draw(glm::mat4 headPose, glm::mat4 projection);
+	//To the RenderQueue
+	void submit();
+	void submit(glm::mat4 world);	//at a snapshot of toWorld
 	void update(double deltaTime);
 
 	//setters
 	void setColor(glm::vec3 c) { color = c; }
-	void setShader(GLuint s) { shader = s; }
+	void setShader(const ShaderProgram * s) { shader = s; }
 	void setModel(Model * m) { model = m; }
 	void setToWorld(glm::mat4 w) { toWorld = w; }
 	void setPosition(glm::vec3 p) { toWorld[3] = glm::vec4(p, 1.0f); }
@@ -37,7 +41,7 @@ private:
 	glm::mat4 toWorld = glm::mat4(1);
 	Model * model = NULL;
 	glm::vec3 color = glm::vec3(1);
-	GLuint shader = 0;
+	const ShaderProgram * shader = NULL;
 	std::vector<std::unique_ptr<Component>> components;
 };
 
@@ -0,0 +1,44 @@
+#pragma once
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+
+//Lock-free hand-off of the latest value from one producer thread to one consumer thread.
+//The producer fills getWriteBuffer() and publishes it, the consumer picks up the newest
+//published value with update(). Neither side ever waits; values the consumer did not get
+//to in time are simply replaced.
+template <typename T>
+class TripleBuffer {
+public:
+	TripleBuffer(const T & initial = T()) {
+		for (int i = 0; i < 3; i++) buffers[i] = initial;
+	}
+
+	//Producer
+	T & getWriteBuffer() { return buffers[back]; }
+	void publish() {
+		int old = middle.exchange(back | FRESH_BIT, std::memory_order_acq_rel);
+		back = old & INDEX_MASK;
+	}
+
+	//Consumer: true if a newer value was published since the last update()
+	bool update() {
+		if (!(middle.load(std::memory_order_acquire) & FRESH_BIT)) return false;
+		int old = middle.exchange(front, std::memory_order_acq_rel);
+		front = old & INDEX_MASK;
+		return true;
+	}
+	const T & getReadBuffer() const { return buffers[front]; }
+
+private:
+	static const int INDEX_MASK = 3;
+	static const int FRESH_BIT = 4;		//set in middle while it holds a value the consumer has not taken
+
+	T buffers[3];
+	int back = 0;					//producer only
+	std::atomic<int> middle{ 1 };	//swapped between the two sides
+	int front = 2;					//consumer only
+};
+
+#endif
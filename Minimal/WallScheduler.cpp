@@ -0,0 +1,61 @@
+#include "WallScheduler.h"
+
+#include <algorithm>
+
+//Weight of the newest measurement in the running pass cost
+#define COST_SMOOTHING 0.1f
+
+WallScheduler::WallScheduler(float budgetMs, int maxDeferFrames) : budget(budgetMs), maxDeferFrames(maxDeferFrames) { }
+
+void WallScheduler::reportCost(float wallTime, int passes) {
+	if (passes <= 0) return;
+
+	float cost = wallTime / passes;
+	if (passCost <= 0.0f) passCost = cost;
+	else passCost += (cost - passCost) * COST_SMOOTHING;
+}
+
+void WallScheduler::schedule(const int staleMask[2], const float priority[2][MAX_WALLS], const int age[2][MAX_WALLS], int wallCount, int renderMask[2]) {
+	//No budget, or nothing measured yet: refresh everything
+	if (budget <= 0.0f || passCost <= 0.0f) {
+		renderMask[0] = staleMask[0];
+		renderMask[1] = staleMask[1];
+		return;
+	}
+
+	float remaining = budget;
+	struct Candidate { int eye, wall; float score; };
+	Candidate candidates[2 * MAX_WALLS];
+	int candidateCount = 0;
+
+	for (int eye = 0; eye < 2; eye++) {
+		renderMask[eye] = 0;
+
+		//Gazed-at wall (highest priority of the visible ones)
+		int gazed = -1;
+		for (int wall = 0; wall < wallCount; wall++) {
+			if (gazed < 0 || priority[eye][wall] > priority[eye][gazed]) gazed = wall;
+		}
+
+		for (int wall = 0; wall < wallCount; wall++) {
+			if (!(staleMask[eye] & (1 << wall))) continue;
+
+			//Gazed-at and overdue walls are refreshed whatever the budget says
+			if (wall == gazed || age[eye][wall] >= maxDeferFrames) {
+				renderMask[eye] |= (1 << wall);
+				remaining -= passCost;
+				continue;
+			}
+
+			//The rest wait in line, closer to the view direction and older first
+			Candidate c = { eye, wall, (priority[eye][wall] + 1.0f) * (age[eye][wall] + 1) };
+			candidates[candidateCount++] = c;
+		}
+	}
+
+	std::sort(candidates, candidates + candidateCount, [](const Candidate & a, const Candidate & b) { return a.score > b.score; });
+	for (int i = 0; i < candidateCount && remaining >= passCost; i++) {
+		renderMask[candidates[i].eye] |= (1 << candidates[i].wall);
+		remaining -= passCost;
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+#ifndef WALL_SCHEDULER_H
+#define WALL_SCHEDULER_H
+
+#include "CaveGeometry.h"
+
+//Picks which stale wall images are refreshed this frame. The wall each eye looks at is always
+//refreshed, the others share what is left of a GPU time budget by view priority and age, so
+//under load peripheral walls drop to every second or third frame instead of the frame being missed.
+class WallScheduler {
+public:
+	WallScheduler(float budgetMs, int maxDeferFrames);
+
+	void schedule(const int staleMask[2], const float priority[2][MAX_WALLS], const int age[2][MAX_WALLS], int wallCount, int renderMask[2]);
+	void reportCost(float wallTime, int passes);	//measured GPU time of an earlier frame's wall passes
+
+	//Setters
+	void setBudget(float ms) { budget = ms; }
+
+	//Getters
+	float getBudget() { return budget; }
+	float getPassCost() { return passCost; }
+
+private:
+	float budget;			//milliseconds of wall passes per frame, <= 0 refreshes everything
+	int maxDeferFrames;		//a stale wall is refreshed after being skipped this many frames
+	float passCost = 0.0f;	//running average of one wall pass (milliseconds)
+};
+
+#endif
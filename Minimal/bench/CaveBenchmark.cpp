@@ -0,0 +1,351 @@
+//Headless CAVE benchmark. Runs Cave, ObjectManager and the Simulation on the simulated HMD in an offscreen
+//EGL context through a fixed set of scenarios and reports frame rate, frame time
+//percentiles, draw calls and GPU time per pass as JSON. Built by bench/CMakeLists.txt;
+//works on software GL (e.g. LIBGL_ALWAYS_SOFTWARE=1 for llvmpipe).
+//
+// Usage: CaveBenchmark [--frames N] [--eye-size W H] [--scenario NAME] [--output FILE]
+//                      [--trace PREFIX] [--data DIR]
+//   --frames     measured frames per scenario (after BENCH_WARMUP_FRAMES)
+//   --scenario   run only this scenario
+//   --output     write the JSON here instead of stdout
+//   --trace      also write the Profiler trace and CSV of every scenario to PREFIX-<scenario>.json/.csv
+//   --data       directory holding shaders/, textures/, models/ and caves/ (defaults to the source tree)
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#define chdir _chdir
+#else
+#include <unistd.h>
+#endif
+
+#include "Definitions.h"
+#include "Cave.h"
+#include "ObjectManager.h"
+#include "SimulatedBackend.h"
+#include "HeadlessContext.h"
+#include "Profiler.h"
+#include "GLState.h"
+#include "RenderQueue.h"
+#include "InputSampler.h"
+#include "Simulation.h"
+
+#define BENCH_FRAMES 300
+#define BENCH_WARMUP_FRAMES 30		//not measured: wall sizes settle and the first images get rendered
+#define BENCH_HAND_EYE_OFFSET 0.0325f	//half the IPD, matching head-in-hand mode in main.cpp
+
+#ifndef CAVE_BENCHMARK_DATA_DIR
+#define CAVE_BENCHMARK_DATA_DIR "."
+#endif
+
+//Controller state, read by the simulation (defined by main.cpp in the app)
+bool Input::buttons[INPUT_BUTTONS] = { false };
+glm::vec2 Input::sticks[2] = { glm::vec2(0, 0), glm::vec2(0, 0) };
+
+struct BenchmarkScenario {
+	const char * name;
+	SimulatedMotion motion;
+	bool headInHand;	//cave eye positions follow the hands instead of the eyes
+	bool frozen;		//cave eye positions stay at the first frame's
+	bool lcd;
+	int cubes;
+};
+
+static const BenchmarkScenario SCENARIOS[] = {
+	{ "static",			SIM_MOTION_STATIC,	false,	false,	true,	1 },
+	{ "walk",			SIM_MOTION_WALK,	false,	false,	true,	1 },
+	{ "head-in-hand",	SIM_MOTION_WALK,	true,	false,	true,	1 },
+	{ "frozen",			SIM_MOTION_WALK,	false,	true,	true,	1 },
+	{ "lcd-off",		SIM_MOTION_WALK,	false,	false,	false,	1 },
+	{ "cubes-100",		SIM_MOTION_WALK,	false,	false,	true,	100 },
+	{ "cubes-10000",	SIM_MOTION_WALK,	false,	false,	true,	10000 },
+};
+#define SCENARIO_COUNT (sizeof(SCENARIOS) / sizeof(SCENARIOS[0]))
+
+struct BenchmarkResult {
+	const BenchmarkScenario * scenario;
+	double fps;
+	double frameP50;	//milliseconds
+	double frameP99;
+	double drawCalls;	//per frame
+	double wallPasses;	//per frame
+	std::vector<ProfileStage> stages;
+};
+
+//==============================================================================FRAME
+//One frame of RiftApp::draw(): simulation hand-off, cave eye positions, wall passes, then the eye passes
+static void drawFrame(HmdBackend * backend, Cave * cave, ObjectManager * objects, InputSampler * inputSampler, Simulation * simulation,
+	GLuint fbo, unsigned int frame, const BenchmarkScenario & scenario, glm::vec3 frozenEyepos[2]) {
+	Profiler::beginFrame(frame);
+	GLState::reset();
+
+	HmdFrame hmd;
+	{
+		PROFILE_SCOPE("pose fetch");
+		hmd = backend->beginFrame(frame);
+	}
+
+	GLState::bindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo);
+	glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, backend->getEyeTexture(), 0);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+	//Updates run on the simulation thread, as in the app
+	{
+		PROFILE_SCOPE("input");
+		SimulationInput in;
+		in.frame = frame;
+		in.time = backend->getTime();
+		if (hmd.inputValid && !inputSampler->isRunning()) inputSampler->sample(hmd.input, in.time);
+		simulation->submit(in);
+	}
+	SceneState scene = simulation->getScene();
+	cave->setScene(scene);
+
+	glm::mat4 views[2];
+	for (int eye = 0; eye < 2; eye++) {
+		glm::ivec4 vp = backend->getViewport(eye);
+		views[eye] = glm::inverse(hmd.eyePoses[eye]);
+
+		glm::vec3 eyepos = glm::vec3(hmd.eyePoses[eye][3]);
+		if (scenario.headInHand) {
+			float offset = (eye == EYE_LEFT) ? -BENCH_HAND_EYE_OFFSET : BENCH_HAND_EYE_OFFSET;
+			eyepos = glm::vec3(glm::translate(hmd.handPoses[HAND_RIGHT], glm::vec3(offset, 0, 0))[3]);
+		}
+		if (scenario.frozen) {
+			if (frame == 1) frozenEyepos[eye] = eyepos;
+			eyepos = frozenEyepos[eye];
+		}
+
+		cave->setEyePos(eyepos, eye);
+		cave->setViewport(glm::vec4(vp.x, vp.y, vp.z, vp.w), eye);
+		cave->setEyeCamera(views[eye], backend->getProjection(eye), eye);
+	}
+
+	cave->renderWalls();
+
+	for (int eye = 0; eye < 2; eye++) {
+		glm::ivec4 vp = backend->getViewport(eye);
+		GLState::viewport(vp.x, vp.y, vp.z, vp.w);
+		{
+			PROFILE_SCOPE(CAVE_EYE_PASS_STAGE(eye));
+			cave->draw(views[eye], backend->getProjection(eye), eye);
+			RenderQueue::begin(views[eye], backend->getProjection(eye));
+			cave->submit(eye);
+			objects->submit(eye, hmd.handPoses);
+			RenderQueue::flush();
+		}
+	}
+
+	glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+	GLState::bindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	RenderQueue::endFrame();
+	GLState::endFrame();
+	{
+		PROFILE_SCOPE("submit");
+		backend->submitFrame(frame);
+	}
+
+	Profiler::endFrame();
+}
+
+//==============================================================================SCENARIO
+static BenchmarkResult runScenario(const BenchmarkScenario & scenario, ObjectManager * objects, glm::uvec2 eyeSize,
+	unsigned int frames, const std::string & tracePrefix) {
+	SimulatedHmdDesc desc;
+	desc.eyeSize = eyeSize;
+	desc.motion = scenario.motion;
+	SimulatedBackend backend(desc);
+	backend.initGl();
+
+	//Eye buffer target, as in RiftApp::initGl()
+	glm::uvec2 size = backend.getRenderTargetSize();
+	GLuint fbo, depthBuffer;
+	glGenFramebuffers(1, &fbo);
+	glGenRenderbuffers(1, &depthBuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, size.x, size.y);
+	glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+
+	//Fresh cave, so no wall image survives from the previous scenario, and a simulation started from it
+	Cave * cave = new Cave();
+	cave->setCubeCount(scenario.cubes);
+	SceneState initial = cave->getScene();
+	initial.displayAsLCD = scenario.lcd;
+	InputSampler * inputSampler = new InputSampler(&backend);
+	inputSampler->start();	//when it cannot, drawFrame() samples once per frame
+	Simulation * simulation = new Simulation(objects, inputSampler, initial);
+	simulation->start();
+
+	if (tracePrefix.empty()) Profiler::open(NULL, NULL);
+	else Profiler::open((tracePrefix + "-" + scenario.name + ".json").c_str(), (tracePrefix + "-" + scenario.name + ".csv").c_str());
+
+	glm::vec3 frozenEyepos[2] = { glm::vec3(0), glm::vec3(0) };
+	std::vector<double> frameTimes;
+	unsigned int drawCalls = 0;
+	int wallPasses = 0;
+	double total = 0.0;
+
+	for (unsigned int frame = 1; frame <= BENCH_WARMUP_FRAMES + frames; frame++) {
+		if (frame == BENCH_WARMUP_FRAMES + 1) {
+			//Measurement starts here
+			Profiler::flush();
+			Profiler::resetStages();
+			Profiler::takeDrawCalls();
+		}
+
+		//Finish every frame so the CPU clock covers the GPU work too
+		auto start = std::chrono::steady_clock::now();
+		drawFrame(&backend, cave, objects, inputSampler, simulation, fbo, frame, scenario, frozenEyepos);
+		glFinish();
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		if (frame <= BENCH_WARMUP_FRAMES) continue;
+		frameTimes.push_back(ms);
+		total += ms;
+		drawCalls += Profiler::takeDrawCalls();
+		wallPasses += cave->getStats().wallPasses;
+	}
+
+	Profiler::flush();
+
+	BenchmarkResult result;
+	result.scenario = &scenario;
+	result.fps = total > 0.0 ? frames * 1000.0 / total : 0.0;
+	std::sort(frameTimes.begin(), frameTimes.end());
+	result.frameP50 = frameTimes.empty() ? 0.0 : frameTimes[(frameTimes.size() - 1) / 2];
+	result.frameP99 = frameTimes.empty() ? 0.0 : frameTimes[(size_t)((frameTimes.size() - 1) * 0.99)];
+	result.drawCalls = frames ? (double)drawCalls / frames : 0.0;
+	result.wallPasses = frames ? (double)wallPasses / frames : 0.0;
+	result.stages = Profiler::getStages();
+
+	Profiler::close();
+	delete(simulation);	//stops its thread before the next scenario's simulation updates the same objects
+	delete(inputSampler);
+	delete(cave);
+	glDeleteRenderbuffers(1, &depthBuffer);
+	glDeleteFramebuffers(1, &fbo);
+	backend.shutdownGl();
+	return result;
+}
+
+//==============================================================================OUTPUT
+//Quoted JSON string: quotes, backslashes and control characters escaped (driver strings can hold any of them)
+static std::string jsonString(const char * s) {
+	std::string out = "\"";
+	for (; s && *s; s++) {
+		char c = *s;
+		if (c == '"' || c == '\\') { out += '\\'; out += c; }
+		else if ((unsigned char)c < 0x20) {
+			char escaped[8];
+			snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned char)c);
+			out += escaped;
+		}
+		else out += c;
+	}
+	return out + "\"";
+}
+
+static void writeJson(FILE * out, const std::vector<BenchmarkResult> & results, glm::uvec2 eyeSize, unsigned int frames) {
+	fprintf(out, "{\n");
+	fprintf(out, "  \"renderer\": %s,\n", jsonString((const char *)glGetString(GL_RENDERER)).c_str());
+	fprintf(out, "  \"eye_size\": [%u, %u],\n", eyeSize.x, eyeSize.y);
+	fprintf(out, "  \"frames\": %u,\n", frames);
+	fprintf(out, "  \"scenarios\": [\n");
+	for (size_t i = 0; i < results.size(); i++) {
+		const BenchmarkResult & r = results[i];
+		fprintf(out, "    {\n");
+		fprintf(out, "      \"name\": %s,\n", jsonString(r.scenario->name).c_str());
+		fprintf(out, "      \"fps\": %.2f,\n", r.fps);
+		fprintf(out, "      \"frame_ms_p50\": %.3f,\n", r.frameP50);
+		fprintf(out, "      \"frame_ms_p99\": %.3f,\n", r.frameP99);
+		fprintf(out, "      \"draw_calls\": %.1f,\n", r.drawCalls);
+		fprintf(out, "      \"wall_passes\": %.2f,\n", r.wallPasses);
+		fprintf(out, "      \"passes\": {");
+		for (size_t s = 0; s < r.stages.size(); s++) {
+			const ProfileStage & stage = r.stages[s];
+			fprintf(out, "%s\n        %s: { \"cpu_ms\": %.3f, \"gpu_ms\": %.3f }", s ? "," : "", jsonString(stage.label.c_str()).c_str(), stage.cpuAverage, stage.gpuAverage);
+		}
+		fprintf(out, "\n      }\n");
+		fprintf(out, "    }%s\n", (i + 1 < results.size()) ? "," : "");
+	}
+	fprintf(out, "  ]\n");
+	fprintf(out, "}\n");
+}
+
+//==============================================================================MAIN
+int main(int argc, char ** argv) {
+	unsigned int frames = BENCH_FRAMES;
+	glm::uvec2 eyeSize = glm::uvec2(1344, 1600);
+	std::string only, outputPath, tracePrefix;
+	std::string dataDir = CAVE_BENCHMARK_DATA_DIR;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--frames" && i + 1 < argc) frames = (unsigned int)atoi(argv[++i]);
+		else if (arg == "--eye-size" && i + 2 < argc) {
+			eyeSize.x = (unsigned int)atoi(argv[++i]);
+			eyeSize.y = (unsigned int)atoi(argv[++i]);
+		}
+		else if (arg == "--scenario" && i + 1 < argc) only = argv[++i];
+		else if (arg == "--output" && i + 1 < argc) outputPath = argv[++i];
+		else if (arg == "--trace" && i + 1 < argc) tracePrefix = argv[++i];
+		else if (arg == "--data" && i + 1 < argc) dataDir = argv[++i];
+		else std::cerr << "Ignoring unknown argument " << arg << std::endl;
+	}
+
+	//Shader, texture, model and cave paths are relative to the project directory
+	if (chdir(dataDir.c_str()) != 0) {
+		std::cerr << "Unable to enter data directory " << dataDir << std::endl;
+		return 1;
+	}
+
+	HeadlessContext context;
+	if (!context.create()) {
+		std::cerr << "Unable to create a headless OpenGL context" << std::endl;
+		return 1;
+	}
+	glewExperimental = GL_TRUE;
+	if (glewContextInit() != GLEW_OK) {
+		std::cerr << "Failed to initialize GLEW" << std::endl;
+		return 1;
+	}
+	glGetError();
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glEnable(GL_DEPTH_TEST);
+
+	RenderQueue::initGl();
+	ObjectManager * objects = new ObjectManager();
+
+	std::vector<BenchmarkResult> results;
+	for (size_t i = 0; i < SCENARIO_COUNT; i++) {
+		if (!only.empty() && only != SCENARIOS[i].name) continue;
+		std::cerr << "Running " << SCENARIOS[i].name << std::endl;
+		results.push_back(runScenario(SCENARIOS[i], objects, eyeSize, frames, tracePrefix));
+	}
+	if (results.empty()) std::cerr << "No scenario named " << only << std::endl;
+
+	FILE * out = outputPath.empty() ? stdout : fopen(outputPath.c_str(), "w");
+	if (out == NULL) std::cerr << "Unable to open " << outputPath << " for writing" << std::endl;
+	else {
+		writeJson(out, results, eyeSize, frames);
+		if (out != stdout) fclose(out);
+	}
+
+	delete(objects);
+	RenderQueue::shutdownGl();
+	context.destroy();
+	return results.empty() ? 1 : 0;
+}
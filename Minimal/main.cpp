@@ -22,7 +22,12 @@ limitations under the License.
 #include <exception>
 #include <algorithm>
 
+#include <string>
+#include <cmath>
+
+#ifdef _WIN32
 #include <Windows.h>
+#endif
 
 #define __STDC_FORMAT_MACROS 1
 
@@ -150,7 +155,9 @@ bool checkGlError()
 void glDebugCallbackHandler(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* msg,
                             GLvoid* data)
 {
+#ifdef _WIN32
   OutputDebugStringA(msg);
+#endif
   std::cout << "debug call: " << msg << std::endl;
 }
 
@@ -164,20 +171,17 @@ void glDebugCallbackHandler(GLenum source, GLenum type, GLuint id, GLenum severi
 #include "Input.h"
 #include "ObjectManager.h"
 #include "Cave.h"
+#include "Simulation.h"
+#include "InputSampler.h"
+#include "HeadlessContext.h"
+#include "Profiler.h"
+#include "DebugDraw.h"
+#include "GLState.h"
+#include "RenderQueue.h"
 
 //init controller
-bool Input::indexTriggerL = false;
-bool Input::handTriggerL = false;
-bool Input::indexTriggerR = false;
-bool Input::handTriggerR = false;
-bool Input::buttonA = false;
-bool Input::buttonB = false;
-bool Input::buttonX = false;
-bool Input::buttonY = false;
-glm::vec2 Input::stickR = glm::vec2(0, 0);
-glm::vec2 Input::stickL = glm::vec2(0, 0);
-bool Input::buttonStickL = false;
-bool Input::buttonStickR = false;
+bool Input::buttons[INPUT_BUTTONS] = { false };
+glm::vec2 Input::sticks[2] = { glm::vec2(0, 0), glm::vec2(0, 0) };
 
 namespace glfw
 {
@@ -203,26 +207,21 @@ protected:
   ivec2 windowPosition;
   GLFWwindow* window{nullptr};
   unsigned int frame{0};
+  unsigned int frameLimit{0};	//stop after this many frames (0 runs until the window closes)
+  bool headless{false};			//no window or GLFW, rendering into an EGL context
+  HeadlessContext headlessContext;
   
   //project vars
   ObjectManager * projectManager;
   Cave * cave;
-
-  //toggles
-  bool a_press = false;
-  bool b_press = false;
-  bool x_press = false;
-  bool y_press = false;
-  bool ls_press = false;
-  bool rs_press = false;
-  bool itr_press = false;
-  bool itl_press = false;
-  bool htr_press = false;
-  bool htl_press = false;
+  Simulation * simulation{nullptr};
+  InputSampler * inputSampler{nullptr};
 
 public:
-  GlfwApp()
+  GlfwApp(bool headless = false) : headless(headless)
   {
+    if (headless) return;
+
     // Initialize the GLFW system for creating and positioning windows
     if (!glfwInit())
     {
@@ -233,35 +232,53 @@ public:
 
   virtual ~GlfwApp()
   {
+	delete(simulation);	//stops its thread before the objects it updates go away
+	delete(inputSampler);
+	delete(projectManager);
+	delete(cave);
     if (nullptr != window)
     {
       glfwDestroyWindow(window);
     }
-    glfwTerminate();
-	delete(projectManager);
-	delete(cave);
+    if (!headless) glfwTerminate();
   }
 
-  virtual int run(){
-    preCreate();
-
-    window = createRenderingTarget(windowSize, windowPosition);
+  void setFrameLimit(unsigned int frames) { frameLimit = frames; }
 
-    if (!window)
+  virtual int run(){
+    if (headless)
     {
-      std::cout << "Unable to create OpenGL window" << std::endl;
-      return -1;
+      if (!headlessContext.create())
+      {
+        std::cout << "Unable to create headless OpenGL context" << std::endl;
+        return -1;
+      }
+      initGlew();
     }
+    else
+    {
+      preCreate();
+
+      window = createRenderingTarget(windowSize, windowPosition);
+
+      if (!window)
+      {
+        std::cout << "Unable to create OpenGL window" << std::endl;
+        return -1;
+      }
 
-    postCreate();
+      postCreate();
+    }
 
     initGl();
 	projectManager = new ObjectManager();
 	cave = new Cave();
+	simulation = new Simulation(projectManager, inputSampler, cave->getScene());
+	simulation->start();
 
-    while (!glfwWindowShouldClose(window)){
+    while (!shouldClose()){
       ++frame;
-      glfwPollEvents();
+      if (!headless) glfwPollEvents();
       update();
       draw();
       finishFrame();
@@ -291,11 +308,16 @@ protected:
 	  glfwSetMouseButtonCallback(window, MouseButtonCallback);
 	  glfwMakeContextCurrent(window);
 
+	  initGlew();
+  }
+
+  void initGlew() {
 	  // Initialize the OpenGL bindings
 	  // For some reason we have to set this experminetal flag to properly
 	  // init GLEW if we use a core context.
+	  // Without a window there is no WGL/GLX display, only the GL entry points are loaded.
 	  glewExperimental = GL_TRUE;
-	  if (0 != glewInit()) {
+	  if (0 != (headless ? glewContextInit() : glewInit())) {
 		  FAIL("Failed to initialize GLEW");
 	  }
 	  glGetError();
@@ -314,7 +336,12 @@ protected:
   virtual void shutdownGl() { }
 
   virtual void finishFrame() {
-	  glfwSwapBuffers(window);
+	  if (!headless) glfwSwapBuffers(window);
+  }
+
+  virtual bool shouldClose() {
+	  if (frameLimit > 0 && frame >= frameLimit) return true;
+	  return !headless && glfwWindowShouldClose(window);
   }
 
   virtual void destroyWindow() {
@@ -363,188 +390,81 @@ private:
 
 //////////////////////////////////////////////////////////////////////
 //
-// The Oculus VR C API provides access to information about the HMD
+// The display backend provides the HMD: the Rift through the Oculus SDK,
+// or a simulated headset for running without one
 //
 
-#include <OVR_CAPI.h>
-#include <OVR_CAPI_GL.h>
-
-namespace ovr
-{
-  // Convenience method for looping over each eye with a lambda
-  template <typename Function>
-  inline void for_each_eye(Function function)
-  {
-    for (ovrEyeType eye = ovrEyeType::ovrEye_Left;
-         eye < ovrEyeType::ovrEye_Count;
-         eye = static_cast<ovrEyeType>(eye + 1))
-    {
-      function(eye);
-    }
-  }
-
-  inline mat4 toGlm(const ovrMatrix4f& om)
-  {
-    return glm::transpose(glm::make_mat4(&om.M[0][0]));
-  }
-
-  inline mat4 toGlm(const ovrFovPort& fovport, float nearPlane = 0.01f, float farPlane = 10000.0f)
-  {
-    return toGlm(ovrMatrix4f_Projection(fovport, nearPlane, farPlane, true));
-  }
-
-  inline vec3 toGlm(const ovrVector3f& ov)
-  {
-    return glm::make_vec3(&ov.x);
-  }
-
-  inline vec2 toGlm(const ovrVector2f& ov)
-  {
-    return glm::make_vec2(&ov.x);
-  }
-
-  inline uvec2 toGlm(const ovrSizei& ov)
-  {
-    return uvec2(ov.w, ov.h);
-  }
-
-  inline quat toGlm(const ovrQuatf& oq)
-  {
-    return glm::make_quat(&oq.x);
-  }
-
-  inline mat4 toGlm(const ovrPosef& op)
-  {
-    mat4 orientation = glm::mat4_cast(toGlm(op.Orientation));
-    mat4 translation = glm::translate(mat4(), ovr::toGlm(op.Position));
-    return translation * orientation;
-  }
-
-  inline ovrMatrix4f fromGlm(const mat4& m)
-  {
-    ovrMatrix4f result;
-    mat4 transposed(glm::transpose(m));
-    memcpy(result.M, &(transposed[0][0]), sizeof(float) * 16);
-    return result;
-  }
-
-  inline ovrVector3f fromGlm(const vec3& v)
-  {
-    ovrVector3f result;
-    result.x = v.x;
-    result.y = v.y;
-    result.z = v.z;
-    return result;
-  }
-
-  inline ovrVector2f fromGlm(const vec2& v)
-  {
-    ovrVector2f result;
-    result.x = v.x;
-    result.y = v.y;
-    return result;
-  }
-
-  inline ovrSizei fromGlm(const uvec2& v)
-  {
-    ovrSizei result;
-    result.w = v.x;
-    result.h = v.y;
-    return result;
-  }
-
-  inline ovrQuatf fromGlm(const quat& q)
-  {
-    ovrQuatf result;
-    result.x = q.x;
-    result.y = q.y;
-    result.z = q.z;
-    result.w = q.w;
-    return result;
-  }
-}
-
-class RiftManagerApp
-{
-protected:
-  ovrSession _session;
-  ovrHmdDesc _hmdDesc;
-  ovrGraphicsLuid _luid;
+#include "HmdBackend.h"
+#include "SimulatedBackend.h"
+#include "TraceBackend.h"
+#include "ResolutionScaler.h"
+#ifdef _WIN32
+#include "OculusBackend.h"
+#endif
+
+//When the desktop window shows the headset's view
+enum MirrorMode {
+  MIRROR_OFF,         //never (after the first frame)
+  MIRROR_INTERVAL,    //every Nth frame
+  MIRROR_ON_DEMAND    //once per press of M
+};
 
-public:
-  RiftManagerApp()
-  {
-    if (!OVR_SUCCESS(ovr_Create(&_session, &_luid)))
-    {
-      FAIL("Unable to create HMD session");
-    }
+struct MirrorPolicy {
+  MirrorMode mode = MIRROR_INTERVAL;
+  unsigned int interval = 1;
+};
 
-    _hmdDesc = ovr_GetHmdDesc(_session);
-  }
+#define MIRROR_COST_SMOOTHING 0.1	//weight of a new sample in the averaged blit and swap time
 
-  ~RiftManagerApp()
-  {
-    ovr_Destroy(_session);
-    _session = nullptr;
-  }
-};
-#include <Windows.h>
-class RiftApp : public GlfwApp, public RiftManagerApp{
+class RiftApp : public GlfwApp{
 public:
 
 private:
   GLuint _fbo{0};
   GLuint _depthBuffer{0};
-  ovrTextureSwapChain _eyeTexture;
 
-  GLuint _mirrorFbo{0};
-  ovrMirrorTexture _mirrorTexture;
-
-  ovrEyeRenderDesc _eyeRenderDescs[2];
+protected:
+  HmdBackend * _backend;
+  ResolutionScaler _resolution;
 
   mat4 _eyeProjections[2];
 
-  ovrLayerEyeFov _sceneLayer;
-  ovrViewScaleDesc _viewScaleDesc;
-
   uvec2 _renderTargetSize;
   uvec2 _mirrorSize;
 
+  //Mirror window
+  MirrorPolicy _mirror;
+  bool _mirrorRequested{false};
+  bool _mirrorThisFrame{false};
+  double _mirrorStart{0.0};
+  double _mirrorCost{0.0};      //averaged blit and swap of a mirrored frame (milliseconds)
+  double _mirrorSaved{0.0};     //estimated milliseconds not spent on skipped frames
+  unsigned int _mirrorSkipped{0};
+
 public:
 
-  RiftApp()
+  RiftApp(HmdBackend * backend, bool headless, float minDensity, float gpuBudget) : GlfwApp(headless), _backend(backend),
+    _resolution(minDensity, backend->getMaxPixelDensity(), gpuBudget)
   {
-    using namespace ovr;
-    _viewScaleDesc.HmdSpaceToWorldScaleInMeters = 1.0f;
-
-    memset(&_sceneLayer, 0, sizeof(ovrLayerEyeFov));
-    _sceneLayer.Header.Type = ovrLayerType_EyeFov;
-    _sceneLayer.Header.Flags = ovrLayerFlag_TextureOriginAtBottomLeft;
-
-    ovr::for_each_eye([&](ovrEyeType eye)
+    for (int eye = 0; eye < 2; eye++)
     {
-      ovrEyeRenderDesc& erd = _eyeRenderDescs[eye] = ovr_GetRenderDesc(_session, eye, _hmdDesc.DefaultEyeFov[eye]);
-      ovrMatrix4f ovrPerspectiveProjection =
-        ovrMatrix4f_Projection(erd.Fov, 0.01f, 1000.0f, ovrProjection_ClipRangeOpenGL);
-      _eyeProjections[eye] = ovr::toGlm(ovrPerspectiveProjection);
-      _viewScaleDesc.HmdToEyePose[eye] = erd.HmdToEyePose;
-
-      ovrFovPort& fov = _sceneLayer.Fov[eye] = _eyeRenderDescs[eye].Fov;
-      auto eyeSize = ovr_GetFovTextureSize(_session, eye, fov, 1.0f);
-      _sceneLayer.Viewport[eye].Size = eyeSize;
-      _sceneLayer.Viewport[eye].Pos = {(int)_renderTargetSize.x, 0};
-
-      _renderTargetSize.y = std::max(_renderTargetSize.y, (uint32_t)eyeSize.h);
-      _renderTargetSize.x += eyeSize.w;
-    });
-    // Make the on screen window 1/4 the resolution of the render target
-    _mirrorSize = _renderTargetSize;
-    _mirrorSize /= 4;
+      _eyeProjections[eye] = _backend->getProjection(eye);
+    }
+    _renderTargetSize = _backend->getRenderTargetSize();
+    _mirrorSize = _backend->getMirrorSize();
   }
 
+  ~RiftApp()
+  {
+    delete(_backend);
+  }
+
+  void setMirrorPolicy(const MirrorPolicy & policy) { _mirror = policy; }
+
 protected:
   GLFWwindow* createRenderingTarget(uvec2& outSize, ivec2& outPosition) override
   {
+    outSize = _mirrorSize;
     return glfw::createWindow(_mirrorSize);
   }
 
@@ -552,62 +472,44 @@ protected:
     GlfwApp::initGl();
 
     // Disable the v-sync for buffer swap
-    glfwSwapInterval(0);
-
-    ovrTextureSwapChainDesc desc = {};
-    desc.Type = ovrTexture_2D;
-    desc.ArraySize = 1;
-    desc.Width = _renderTargetSize.x;
-    desc.Height = _renderTargetSize.y;
-    desc.MipLevels = 1;
-    desc.Format = OVR_FORMAT_R8G8B8A8_UNORM_SRGB;
-    desc.SampleCount = 1;
-    desc.StaticImage = ovrFalse;
-    ovrResult result = ovr_CreateTextureSwapChainGL(_session, &desc, &_eyeTexture);
-    _sceneLayer.ColorTexture[0] = _eyeTexture;
-    if (!OVR_SUCCESS(result))
-    {
-      FAIL("Failed to create swap textures");
-    }
+    if (!headless) glfwSwapInterval(0);
 
-    int length = 0;
-    result = ovr_GetTextureSwapChainLength(_session, _eyeTexture, &length);
-    if (!OVR_SUCCESS(result) || !length)
-    {
-      FAIL("Unable to count swap chain textures");
-    }
-    for (int i = 0; i < length; ++i)
-    {
-      GLuint chainTexId;
-      ovr_GetTextureSwapChainBufferGL(_session, _eyeTexture, i, &chainTexId);
-      glBindTexture(GL_TEXTURE_2D, chainTexId);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    }
-    glBindTexture(GL_TEXTURE_2D, 0);
+    _backend->initGl();
+    _resolution.initGl();
+    DebugDraw::initGl();
+    RenderQueue::initGl();
+
+    //Controllers are polled on a thread of their own where the backend allows it
+    inputSampler = new InputSampler(_backend);
+    if (!inputSampler->start()) std::cout << "Controller input is sampled once per frame" << std::endl;
+    _backend->setPixelDensity(_resolution.getDensity());
 
     // Set up the framebuffer object
     glGenFramebuffers(1, &_fbo);
     glGenRenderbuffers(1, &_depthBuffer);
     glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _fbo);
     glBindRenderbuffer(GL_RENDERBUFFER, _depthBuffer);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, _renderTargetSize.x, _renderTargetSize.y);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, _renderTargetSize.x, _renderTargetSize.y);
     glBindRenderbuffer(GL_RENDERBUFFER, 0);
-    glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, _depthBuffer);
+    glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, _depthBuffer);
     glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+  }
 
-    ovrMirrorTextureDesc mirrorDesc;
-    memset(&mirrorDesc, 0, sizeof(mirrorDesc));
-    mirrorDesc.Format = OVR_FORMAT_R8G8B8A8_UNORM_SRGB;
-    mirrorDesc.Width = _mirrorSize.x;
-    mirrorDesc.Height = _mirrorSize.y;
-    if (!OVR_SUCCESS(ovr_CreateMirrorTextureGL(_session, &mirrorDesc, &_mirrorTexture)))
-    {
-      FAIL("Could not create mirror texture");
-    }
-    glGenFramebuffers(1, &_mirrorFbo);
+  bool shouldClose() override
+  {
+    return _backend->isFinished() || GlfwApp::shouldClose();
+  }
+
+  void shutdownGl() override
+  {
+    glDeleteRenderbuffers(1, &_depthBuffer);
+    glDeleteFramebuffers(1, &_fbo);
+    Profiler::close();
+    inputSampler->stop();	//polls the backend, which goes away with the app
+    RenderQueue::shutdownGl();
+    DebugDraw::shutdownGl();
+    _resolution.shutdownGl();
+    _backend->shutdownGl();
   }
 
   void onKey(int key, int scancode, int action, int mods) override
@@ -616,238 +518,198 @@ protected:
       switch (key)
       {
       case GLFW_KEY_R:
-        ovr_RecenterTrackingOrigin(_session);
+        _backend->recenter();
+        return;
+      case GLFW_KEY_P:
+        {
+          CaveStats stats = cave->getStats();
+          std::cout << "Mirror skipped " << _mirrorSkipped << " frames, saved " << _mirrorSaved << " ms (" << _mirrorCost << " ms per mirrored frame)" << std::endl;
+          std::cout << "Eye buffer density: " << _resolution.getDensity() << " (GPU " << _resolution.getGpuTime() << " of " << _resolution.getBudget() << " ms)" << std::endl;
+          std::cout << "Cave (" << Cave::getRenderModeName(cave->getRenderMode()) << ") wall passes: " << stats.wallPasses << ", culled: " << stats.culledWalls << ", cached: " << stats.cachedWalls << ", reprojected: " << stats.reprojectedWalls << ", deferred: " << stats.deferredWalls << ", GPU: " << stats.gpuTime << " ms (walls " << stats.wallGpuTime << " ms)" << std::endl;
+        }
+        return;
+      case GLFW_KEY_B:
+        cave->benchmarkRenderModes();
+        return;
+      case GLFW_KEY_M:
+        _mirrorRequested = true;
         return;
       }
 
     GlfwApp::onKey(key, scancode, action, mods);
   }
 
+  void finishFrame() override
+  {
+    if (!_mirrorThisFrame) return;
+    {
+      PROFILE_SCOPE("mirror swap");
+      GlfwApp::finishFrame();
+    }
+    double cost = (glfwGetTime() - _mirrorStart) * 1000.0;
+    _mirrorCost = _mirrorCost > 0.0 ? _mirrorCost + (cost - _mirrorCost) * MIRROR_COST_SMOOTHING : cost;
+  }
+
+  //Whether this frame is blitted to the window and swapped
+  bool shouldMirror()
+  {
+    //Nothing to mirror to without a window, and nobody sees a hidden or minimized one
+    if (headless) return false;
+    if (glfwGetWindowAttrib(window, GLFW_ICONIFIED) || !glfwGetWindowAttrib(window, GLFW_VISIBLE)) return false;
+    //The first frame always goes out, so the window is not left blank and the cost is measured
+    if (frame == 1) return true;
+
+    switch (_mirror.mode)
+    {
+    case MIRROR_INTERVAL:
+      return _mirror.interval <= 1 || frame % _mirror.interval == 0;
+    case MIRROR_ON_DEMAND:
+      if (!_mirrorRequested) return false;
+      _mirrorRequested = false;
+      return true;
+    default:
+      return false;
+    }
+  }
+
   //==============================================================================PROJECT VARIABLES
-	double lastTime = 0;
 	glm::mat4 lastView [2] = { glm::mat4(1), glm::mat4(1) };
 	glm::vec3 lastEyepos[2] = { glm::vec3(0), glm::vec3(0) };
-	bool freezeCave = false;
 
-	void draw() final override {
-		ovrPosef eyePoses[2];
-		ovr_GetEyePoses(_session, frame, true, _viewScaleDesc.HmdToEyePose, eyePoses, &_sceneLayer.SensorSampleTime);
-
-		int curIndex;
-		ovr_GetTextureSwapChainCurrentIndex(_session, _eyeTexture, &curIndex);
-		GLuint curTexId;
-		ovr_GetTextureSwapChainBufferGL(_session, _eyeTexture, curIndex, &curTexId);
-		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _fbo);
-		glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, curTexId, 0);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-		//==============================================================================CONTROLLER
-		// Query Touch controllers. Query their parameters:
-		double displayMidpointSeconds = ovr_GetPredictedDisplayTime(_session, 0);
-		ovrTrackingState trackState = ovr_GetTrackingState(_session, displayMidpointSeconds, ovrTrue);
-
-		// Process controller status. Useful to know if controller is being used at all, and if the cameras can see it. 
-		// Bits reported:
-		// Bit 1: ovrStatus_OrientationTracked  = Orientation is currently tracked (connected and in use)
-		// Bit 2: ovrStatus_PositionTracked     = Position is currently tracked (false if out of range)
-		unsigned int handStatus[2];
-		handStatus[0] = trackState.HandStatusFlags[0];
-		handStatus[1] = trackState.HandStatusFlags[1];
-
-		// Process controller position and orientation:
-		ovrPosef handPoses[2];  // These are position and orientation in meters in room coordinates, relative to tracking origin. Right-handed cartesian coordinates.
-								// ovrQuatf     Orientation;
-								// ovrVector3f  Position;
-		handPoses[0] = trackState.HandPoses[0].ThePose;
-		handPoses[1] = trackState.HandPoses[1].ThePose;
-		ovrVector3f handPosition[2];
-		handPosition[0] = handPoses[0].Position;
-		handPosition[1] = handPoses[1].Position;
-
-		//=============================================================================BUTTON PRESSES
-		{
-			ovrInputState inputState;
-
-			if (OVR_SUCCESS(ovr_GetInputState(_session, ovrControllerType_Touch, &inputState))) {
-				//Index Trigger
-				Input::setIndexTriggerL((inputState.IndexTrigger[ovrHand_Left] > 0.5f));
-				Input::setIndexTriggerR((inputState.IndexTrigger[ovrHand_Right] > 0.5f));
-
-				//Hand Trigger
-				Input::setHandTriggerL((inputState.HandTrigger[ovrHand_Left] > 0.5f));
-				Input::setHandTriggerR((inputState.HandTrigger[ovrHand_Right] > 0.5f));
-
-				//Buttons
-				Input::setButtonA(inputState.Buttons & ovrButton_A);
-				Input::setButtonB(inputState.Buttons & ovrButton_B);
-				Input::setButtonX(inputState.Buttons & ovrButton_X);
-				Input::setButtonY(inputState.Buttons & ovrButton_Y);
-
-				//Sticks
-				Input::setStickL(ovr::toGlm(inputState.Thumbstick[0]));
-				Input::setStickR(ovr::toGlm(inputState.Thumbstick[1]));
-				Input::setButtonStickL(inputState.Buttons & ovrButton_LThumb);
-				Input::setButtonStickR(inputState.Buttons & ovrButton_RThumb);
-			}
-		}
-		//==============================================================================CONTROLLER BUTTON HANDLING
-		{
-			//Left Stick
-			cave->moveCube(glm::vec3(Input::getStickL().x, 0, Input::getStickL().y));
-			//Right Stick
-			cave->moveCube(glm::vec3(0, Input::getStickR().y, 0));
-			cave->setCubeScale(Input::getStickR().x);
-			//Hand Trigger - Right
-			if (Input::getHandTriggerR()) {
-				if (!htr_press) {
-					htr_press = true;
-					//TODO
-				}
-			}
-			else htr_press = false;
+	//Tracked eye position the CAVE renders from (the eye, a hand in head-in-hand mode, or last frame's when frozen)
+	glm::vec3 getCaveEyePos(const HmdFrame & hmd, const SceneState & scene, int eye) {
+		glm::vec3 eyepos = glm::vec3(hmd.eyePoses[eye][3]);
+		//---------------------------------------------------Head in hand mode
+		if (scene.headInHandL || scene.headInHandR) {
+			glm::mat4 caveView;
+			if (scene.headInHandL) caveView = hmd.handPoses[HAND_LEFT];
+			if (scene.headInHandR) caveView = hmd.handPoses[HAND_RIGHT];
 
-			//Hand Trigger - Left
-			if (Input::getHandTriggerL()) {
-				if (!htl_press) {
-					htl_press = true;
-					//TODO
-				}
-			}
-			else htl_press = false;
+			if (eye == EYE_LEFT)	caveView = glm::translate(caveView, glm::vec3(-0.0325f, 0, 0));	//left 
+			else					caveView = glm::translate(caveView, glm::vec3(0.0325f, 0, 0));	//right
 
-			//Index Trigger - Right
-			if (Input::getIndexTriggerR()) {
-				if (!itr_press) {
-					itr_press = true;
-					//TODO
-				}
-			}
-			else itr_press = false;
+			eyepos = caveView[3];
+		}
+		//---------------------------------------------------Freeze cave tracking
+		if (scene.freezeCave) eyepos = lastEyepos[eye];
+		return eyepos;
+	}
 
-			//Index Trigger - Left
-			if (Input::getIndexTriggerL()) {
-				if (!itl_press) {
-					itl_press = true;
-					//TODO
-				}
-			}
-			else itl_press = false;
+	void draw() final override {
+		Profiler::beginFrame(frame);
+		GLState::reset();	//the compositor and the mirror blit changed state since the last frame
+		_resolution.beginFrame();
 
-			//Button X
-			if (Input::getButtonX()) {
-				if (!x_press) {
-					x_press = true;
-					cave->toggleLCD();
-				}
-			}
-			else x_press = false;
-			//Button Y
-			if (Input::getButtonY()) {
-				if (!y_press) {
-					y_press = true;
-					//TODO
-				}
-			}
-			else y_press = false;
-			//Button B
-			if (Input::getButtonB()) {
-				if (!b_press) {
-					b_press = true;
-					freezeCave = !freezeCave;
-				}
-			}
-			else b_press = false;
-			//Button A
-			if (Input::getButtonA()) {
-				if (!a_press) {
-					a_press = true;
-					//TODO
-				}
-			}
-			else a_press = false;
-			//Button LS
-			if (Input::getButtonStickL()) {
-				if (!ls_press) {
-					ls_press = true;
-					cave->resetCubePosition();
-				}
-			}
-			else ls_press = false;
-			//Button RS
-			if (Input::getButtonStickR()) {
-				if (!rs_press) {
-					rs_press = true;
-					cave->resetCubeScale();
-				}
-			}
-			else rs_press = false;
-		}
-		//==============================================================================UPDATE
+		//Poses and controller state of this frame
+		HmdFrame hmd;
 		{
-			//Update hand positions
-			projectManager->updateHands(ovr::toGlm(handPoses[ovrHand_Left]), ovr::toGlm(handPoses[ovrHand_Right]));
+			PROFILE_SCOPE("pose fetch");
+			hmd = _backend->beginFrame(frame);
+		}
 
-			//Calls update in children
-			projectManager->update(ovr_GetTimeInSeconds() - lastTime);
-			cave->update(ovr_GetTimeInSeconds() - lastTime);
-			lastTime = ovr_GetTimeInSeconds();
+		GLState::bindFramebuffer(GL_DRAW_FRAMEBUFFER, _fbo);
+		glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _backend->getEyeTexture(), 0);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+		//==============================================================================SIMULATION
+		{
+			PROFILE_SCOPE("input");
+			//Controller handling and updates run on the simulation thread
+			SimulationInput in;
+			in.frame = frame;
+			in.time = _backend->getTime();
+			//Without the sampler thread this frame's controller state becomes the events
+			if (hmd.inputValid && !inputSampler->isRunning()) inputSampler->sample(hmd.input, in.time);
+			simulation->submit(in);
 		}
+		//Newest state it has published (never waits for this frame's input to be simulated), between its last two steps
+		SceneState scene = simulation->getScene();
+		cave->setScene(scene);
 		//==============================================================================DRAW
 		{
-			ovr::for_each_eye([&](ovrEyeType eye) {
-				//---------------------------------------------------Setup
-				const auto& vp = _sceneLayer.Viewport[eye];
-				glViewport(vp.Pos.x, vp.Pos.y, vp.Size.w, vp.Size.h);
-				_sceneLayer.RenderPose[eye] = eyePoses[eye];
+			glm::mat4 views[2];
+			//---------------------------------------------------Late latch: poses again now that the simulation hand-off is done
+			{
+				PROFILE_SCOPE("pose latch");
+				_backend->latchPoses(frame, hmd);
+			}
+			//---------------------------------------------------Cave eye positions (both eyes)
+			for (int eye = 0; eye < 2; eye++) {
+				glm::ivec4 vp = _backend->getViewport(eye);
 				//---------------------------------------------------View Matrix
-				glm::mat4 view = glm::inverse(ovr::toGlm(eyePoses[eye]));
-				glm::mat4 projection = _eyeProjections[eye];
-				//---------------------------------------------------Cave Vars
-				glm::mat4 caveView = glm::inverse(ovr::toGlm(eyePoses[eye]));
-				glm::vec3 eyepos = ovr::toGlm(eyePoses[eye].Position);
-				//---------------------------------------------------Head in hand mode
-				if (itl_press || itr_press) {
-					if (itl_press) caveView = ovr::toGlm(handPoses[ovrHand_Left]);
-					if (itr_press) caveView = ovr::toGlm(handPoses[ovrHand_Right]);
-
-					if (eye == ovrEye_Left)	caveView = glm::translate(caveView, glm::vec3(-0.0325f, 0, 0));	//left 
-					else					caveView = glm::translate(caveView, glm::vec3(0.0325f, 0, 0));	//right
-
-					eyepos = caveView[3];
-				}
-				//---------------------------------------------------Freeze cave tracking
-				if (freezeCave) eyepos = lastEyepos[eye];
+				views[eye] = glm::inverse(hmd.eyePoses[eye]);
+				glm::vec3 eyepos = getCaveEyePos(hmd, scene, eye);
 				//---------------------------------------------------Send to Cave
 				cave->setEyePos(eyepos, eye);
-				cave->setViewport(glm::vec4(vp.Pos.x, vp.Pos.y, vp.Size.w, vp.Size.h), eye);
-				//---------------------------------------------------Draw debug pyramids
-				if (a_press) {
-					cave->drawDebugLines(view, projection, lastEyepos[ovrEye_Left], ovrEye_Left);	//Draw left eye debug
-					cave->drawDebugLines(view, projection, lastEyepos[ovrEye_Right], ovrEye_Right);	//Draw right eye debug
-				}
-				//---------------------------------------------------Render Scene
-				projectManager->draw(view, projection, eye);
-				cave->draw(view, projection, eye);
+				cave->setViewport(glm::vec4(vp.x, vp.y, vp.z, vp.w), eye);
+				cave->setEyeCamera(views[eye], _eyeProjections[eye], eye);
 				//---------------------------------------------------Store variables for next frame
-				lastView[eye] = view;
+				lastView[eye] = views[eye];
 				lastEyepos[eye] = eyepos;
-			});
+			}
+			//---------------------------------------------------Debug pyramids, queued once and drawn in both eye passes
+			if (scene.debugLines) {
+				cave->addDebugLines(lastEyepos[EYE_LEFT], EYE_LEFT);
+				cave->addDebugLines(lastEyepos[EYE_RIGHT], EYE_RIGHT);
+			}
+			DebugDraw::upload();
+			//---------------------------------------------------Render every wall image before any of them is sampled
+			cave->renderWalls();	//profiled as "cave walls"
+			//---------------------------------------------------Eye passes
+			for (int eye = 0; eye < 2; eye++) {
+				//---------------------------------------------------Latch this eye once more, its wall images are reprojected to the newer position
+				_backend->latchPoses(frame, hmd, eye);
+				views[eye] = glm::inverse(hmd.eyePoses[eye]);
+				lastView[eye] = views[eye];
+				lastEyepos[eye] = getCaveEyePos(hmd, scene, eye);
+				cave->setEyePos(lastEyepos[eye], eye);
+				cave->setEyeCamera(views[eye], _eyeProjections[eye], eye);
+				//---------------------------------------------------Setup
+				glm::ivec4 vp = _backend->getViewport(eye);
+				GLState::viewport(vp.x, vp.y, vp.z, vp.w);
+				glm::mat4 view = views[eye];
+				glm::mat4 projection = _eyeProjections[eye];
+				//---------------------------------------------------Draw debug lines
+				DebugDraw::draw(view, projection);
+				//---------------------------------------------------Render Scene, one queue for the cave walls, hands and skybox
+				{
+					PROFILE_SCOPE(CAVE_EYE_PASS_STAGE(eye));
+					cave->draw(view, projection, eye);	//stencil mode only, before the queue
+					RenderQueue::begin(view, projection);
+					cave->submit(eye);
+					projectManager->submit(eye, hmd.handPoses);	//as latched for this eye
+					RenderQueue::flush();
+				}
+			}
+			DebugDraw::endFrame();
 		}
 		//=================================================================================
 
 		glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
-		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-		ovr_CommitTextureSwapChain(_session, _eyeTexture);
-		ovrLayerHeader* headerList = &_sceneLayer.Header;
-		ovr_SubmitFrame(_session, frame, &_viewScaleDesc, &headerList, 1);
-
-		GLuint mirrorTextureId;
-		ovr_GetMirrorTextureBufferGL(_session, _mirrorTexture, &mirrorTextureId);
-		glBindFramebuffer(GL_READ_FRAMEBUFFER, _mirrorFbo);
-		glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mirrorTextureId, 0);
-		glBlitFramebuffer(0, 0, _mirrorSize.x, _mirrorSize.y, 0, _mirrorSize.y, _mirrorSize.x, 0, GL_COLOR_BUFFER_BIT,
-			GL_NEAREST);
-		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+		GLState::bindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+		RenderQueue::endFrame();
+		GLState::endFrame();
+		//Next frame's eye viewports (and the layer's, the compositor upsamples them), from the GPU time of earlier frames
+		_backend->setPixelDensity(_resolution.endFrame());
+		{
+			PROFILE_SCOPE("submit");
+			_backend->submitFrame(frame);
+		}
+
+		//Mirror window, per policy; a skipped frame reports the blit and swap it did not pay for
+		_mirrorThisFrame = shouldMirror();
+		if (_mirrorThisFrame) {
+			PROFILE_SCOPE("mirror blit");
+			_mirrorStart = glfwGetTime();
+			_backend->blitMirror(_mirrorSize);
+		}
+		else if (!headless) {
+			_mirrorSkipped++;
+			_mirrorSaved += _mirrorCost;
+			Profiler::counter("mirror saved ms", _mirrorCost);
+		}
+
+		Profiler::endFrame();
 	}
 };
 
@@ -864,28 +726,105 @@ protected:
 // An example application that renders a simple cube
 class Project : public RiftApp{
 public:
-	Project(){ }
+	Project(HmdBackend * backend, bool headless, float minDensity, float gpuBudget) : RiftApp(backend, headless, minDensity, gpuBudget) { }
 
 protected:
 	void initGl() override{
 		RiftApp::initGl();
 		glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
 		glEnable(GL_DEPTH_TEST);
-		ovr_RecenterTrackingOrigin(_session);
+		_backend->recenter();
 	}
 
-	void shutdownGl() override{ }
+	void shutdownGl() override{
+		RiftApp::shutdownGl();
+	}
 };
 
 // Execute our example class
+// Usage: Minimal [--simulate | --headless] [--frames N] [--fov DEGREES] [--eye-size W H] [--motion static|walk|look]
+//                [--record FILE | --replay FILE] [--profile PREFIX] [--density MIN MAX] [--gpu-budget MS]
+//                [--mirror off|demand|N]
+//   --simulate   render to a simulated HMD (mirrored to a window) instead of the Rift
+//   --headless   simulated HMD without a window, through an EGL context (Linux build, CMakeLists.txt)
+//   --record     write every frame's poses and controller input to a trace
+//   --replay     feed a recorded trace instead of live poses and input (exits when it ends)
+//   --profile    time every stage on CPU and GPU, written to PREFIX.json (chrome://tracing) and PREFIX.csv
+//   --density    pixel density range of the eye buffer (1 is native), scaled to keep the GPU within --gpu-budget
+//   --mirror     desktop window: off, on demand (M key) or every Nth frame (default every frame)
 int main(int argc, char** argv){
   int result = -1;
 
-  if (!OVR_SUCCESS(ovr_Initialize(nullptr))){
-    FAIL("Failed to initialize the Oculus SDK");
+  bool simulate = false;
+  bool headless = false;
+  unsigned int frames = 0;
+  const char * recordPath = nullptr;
+  const char * replayPath = nullptr;
+  std::string profilePrefix;
+  float minDensity = 1.0f;
+  float maxDensity = 1.0f;
+  float gpuBudget = RESOLUTION_DEFAULT_BUDGET;
+  MirrorPolicy mirror;
+  SimulatedHmdDesc desc;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--simulate") simulate = true;
+    else if (arg == "--headless") simulate = headless = true;
+    else if (arg == "--frames" && i + 1 < argc) frames = (unsigned int)atoi(argv[++i]);
+    else if (arg == "--fov" && i + 1 < argc) {
+      float tangent = tanf(glm::radians((float)atof(argv[++i])) * 0.5f);
+      desc.fov[0] = desc.fov[1] = glm::vec4(tangent);
+    }
+    else if (arg == "--eye-size" && i + 2 < argc) {
+      desc.eyeSize.x = (unsigned int)atoi(argv[++i]);
+      desc.eyeSize.y = (unsigned int)atoi(argv[++i]);
+    }
+    else if (arg == "--motion" && i + 1 < argc) {
+      std::string motion = argv[++i];
+      if (motion == "walk") desc.motion = SIM_MOTION_WALK;
+      else if (motion == "look") desc.motion = SIM_MOTION_LOOK;
+      else desc.motion = SIM_MOTION_STATIC;
+    }
+    else if (arg == "--record" && i + 1 < argc) recordPath = argv[++i];
+    else if (arg == "--replay" && i + 1 < argc) replayPath = argv[++i];
+    else if (arg == "--profile" && i + 1 < argc) profilePrefix = argv[++i];
+    else if (arg == "--density" && i + 2 < argc) {
+      minDensity = (float)atof(argv[++i]);
+      maxDensity = (float)atof(argv[++i]);
+    }
+    else if (arg == "--gpu-budget" && i + 1 < argc) gpuBudget = (float)atof(argv[++i]);
+    else if (arg == "--mirror" && i + 1 < argc) {
+      std::string policy = argv[++i];
+      if (policy == "off") mirror.mode = MIRROR_OFF;
+      else if (policy == "demand") mirror.mode = MIRROR_ON_DEMAND;
+      else {
+        mirror.mode = MIRROR_INTERVAL;
+        mirror.interval = (unsigned int)std::max(atoi(policy.c_str()), 1);
+      }
+    }
+    else std::cerr << "Ignoring unknown argument " << arg << std::endl;
   }
-  result = Project().run();
 
-  ovr_Shutdown();
+  HmdBackend * backend = nullptr;
+  desc.maxPixelDensity = maxDensity;
+  if (simulate) backend = new SimulatedBackend(desc);
+  else {
+#ifdef _WIN32
+    backend = new OculusBackend(maxDensity);
+#else
+    std::cerr << "The Rift needs the Oculus SDK (Windows), use --simulate or --headless" << std::endl;
+    return result;
+#endif
+  }
+  if (replayPath) backend = new TraceBackend(backend, replayPath, TRACE_REPLAY);
+  else if (recordPath) backend = new TraceBackend(backend, recordPath, TRACE_RECORD);
+
+  if (!profilePrefix.empty()) Profiler::open((profilePrefix + ".json").c_str(), (profilePrefix + ".csv").c_str());
+
+  Project project(backend, headless, minDensity, gpuBudget);
+  project.setFrameLimit(frames);
+  project.setMirrorPolicy(mirror);
+  result = project.run();
+
   return result;
 }
@@ -16,90 +16,53 @@ using namespace std;
 
 #include "shader.h"
 
-GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path){
-
-	// Create the shaders
-	GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
-	GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
-
-	// Read the Vertex Shader code from the file
-	std::string VertexShaderCode;
-	std::ifstream VertexShaderStream(vertex_file_path, std::ios::in);
-	if(VertexShaderStream.is_open()){
-		std::string Line = "";
-		while(getline(VertexShaderStream, Line))
-			VertexShaderCode += "\n" + Line;
-		VertexShaderStream.close();
-	}else{
-		printf("Impossible to open %s. Check to make sure the file exists and you passed in the right filepath!\n", vertex_file_path);
-		printf("The current working directory is:");
-#ifdef _WIN32
-		system("CD");
-#else
-		system("pwd");
-#endif
-		getchar();
-		return 0;
-	}
-
-	// Read the Fragment Shader code from the file
-	std::string FragmentShaderCode;
-	std::ifstream FragmentShaderStream(fragment_file_path, std::ios::in);
-	if(FragmentShaderStream.is_open()){
-		std::string Line = "";
-		while(getline(FragmentShaderStream, Line))
-			FragmentShaderCode += "\n" + Line;
-		FragmentShaderStream.close();
-	}
+static bool ReadShaderFile(const char * file_path, std::string & code){
+	std::ifstream ShaderStream(file_path, std::ios::in);
+	if(!ShaderStream.is_open())
+		return false;
+
+	std::string Line = "";
+	while(getline(ShaderStream, Line))
+		code += "\n" + Line;
+	ShaderStream.close();
+	return true;
+}
 
+static GLuint CompileShader(GLenum type, const char * file_path, const std::string & code){
+	GLuint ShaderID = glCreateShader(type);
 	GLint Result = GL_FALSE;
 	int InfoLogLength;
 
+	// Compile Shader
+	printf("Compiling shader : %s\n", file_path);
+	char const * SourcePointer = code.c_str();
+	glShaderSource(ShaderID, 1, &SourcePointer , NULL);
+	glCompileShader(ShaderID);
 
-	// Compile Vertex Shader
-	printf("Compiling shader : %s\n", vertex_file_path);
-	char const * VertexSourcePointer = VertexShaderCode.c_str();
-	glShaderSource(VertexShaderID, 1, &VertexSourcePointer , NULL);
-	glCompileShader(VertexShaderID);
-
-	// Check Vertex Shader
-	glGetShaderiv(VertexShaderID, GL_COMPILE_STATUS, &Result);
-	glGetShaderiv(VertexShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
+	// Check Shader
+	glGetShaderiv(ShaderID, GL_COMPILE_STATUS, &Result);
+	glGetShaderiv(ShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
 	if ( InfoLogLength > 0 ){
-		std::vector<char> VertexShaderErrorMessage(InfoLogLength+1);
-		glGetShaderInfoLog(VertexShaderID, InfoLogLength, NULL, &VertexShaderErrorMessage[0]);
-		printf("%s\n", &VertexShaderErrorMessage[0]);
+		std::vector<char> ShaderErrorMessage(InfoLogLength+1);
+		glGetShaderInfoLog(ShaderID, InfoLogLength, NULL, &ShaderErrorMessage[0]);
+		printf("%s\n", &ShaderErrorMessage[0]);
 	}
 	else {
-		printf("Successfully compiled vertex shader!\n");
+		printf("Successfully compiled shader!\n");
 	}
 
+	return ShaderID;
+}
 
-
-	// Compile Fragment Shader
-	printf("Compiling shader : %s\n", fragment_file_path);
-	char const * FragmentSourcePointer = FragmentShaderCode.c_str();
-	glShaderSource(FragmentShaderID, 1, &FragmentSourcePointer , NULL);
-	glCompileShader(FragmentShaderID);
-
-	// Check Fragment Shader
-	glGetShaderiv(FragmentShaderID, GL_COMPILE_STATUS, &Result);
-	glGetShaderiv(FragmentShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-	if ( InfoLogLength > 0 ){
-		std::vector<char> FragmentShaderErrorMessage(InfoLogLength+1);
-		glGetShaderInfoLog(FragmentShaderID, InfoLogLength, NULL, &FragmentShaderErrorMessage[0]);
-		printf("%s\n", &FragmentShaderErrorMessage[0]);
-	}
-	else {
-		printf("Successfully compiled fragment shader!\n");
-	}
-
+static GLuint LinkProgram(const std::vector<GLuint> & shaders){
+	GLint Result = GL_FALSE;
+	int InfoLogLength;
 
 	// Link the program
 	printf("Linking program\n");
 	GLuint ProgramID = glCreateProgram();
-	glAttachShader(ProgramID, VertexShaderID);
-	glAttachShader(ProgramID, FragmentShaderID);
+	for (size_t i = 0; i < shaders.size(); i++)
+		glAttachShader(ProgramID, shaders[i]);
 	glLinkProgram(ProgramID);
 
 	// Check the program
@@ -110,12 +73,65 @@ GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path
 		glGetProgramInfoLog(ProgramID, InfoLogLength, NULL, &ProgramErrorMessage[0]);
 		printf("%s\n", &ProgramErrorMessage[0]);
 	}
-	
-	glDetachShader(ProgramID, VertexShaderID);
-	glDetachShader(ProgramID, FragmentShaderID);
-	
-	glDeleteShader(VertexShaderID);
-	glDeleteShader(FragmentShaderID);
+
+	for (size_t i = 0; i < shaders.size(); i++){
+		glDetachShader(ProgramID, shaders[i]);
+		glDeleteShader(shaders[i]);
+	}
 
 	return ProgramID;
 }
+
+static void ReportMissingFile(const char * file_path){
+	printf("Impossible to open %s. Check to make sure the file exists and you passed in the right filepath!\n", file_path);
+	printf("The current working directory is:");
+#ifdef _WIN32
+	system("CD");
+#else
+	system("pwd");
+#endif
+	getchar();
+}
+
+GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path){
+	// Read the Vertex Shader code from the file
+	std::string VertexShaderCode;
+	if(!ReadShaderFile(vertex_file_path, VertexShaderCode)){
+		ReportMissingFile(vertex_file_path);
+		return 0;
+	}
+
+	// Read the Fragment Shader code from the file
+	std::string FragmentShaderCode;
+	ReadShaderFile(fragment_file_path, FragmentShaderCode);
+
+	std::vector<GLuint> shaders;
+	shaders.push_back(CompileShader(GL_VERTEX_SHADER, vertex_file_path, VertexShaderCode));
+	shaders.push_back(CompileShader(GL_FRAGMENT_SHADER, fragment_file_path, FragmentShaderCode));
+
+	return LinkProgram(shaders);
+}
+
+GLuint LoadShaders(const char * vertex_file_path, const char * geometry_file_path, const char * fragment_file_path){
+	// Read the Vertex and Geometry Shader code from the files
+	std::string VertexShaderCode, GeometryShaderCode;
+	if(!ReadShaderFile(vertex_file_path, VertexShaderCode)){
+		ReportMissingFile(vertex_file_path);
+		return 0;
+	}
+	if(!ReadShaderFile(geometry_file_path, GeometryShaderCode)){
+		ReportMissingFile(geometry_file_path);
+		return 0;
+	}
+
+	// Read the Fragment Shader code from the file
+	std::string FragmentShaderCode;
+	ReadShaderFile(fragment_file_path, FragmentShaderCode);
+
+	std::vector<GLuint> shaders;
+	shaders.push_back(CompileShader(GL_VERTEX_SHADER, vertex_file_path, VertexShaderCode));
+	shaders.push_back(CompileShader(GL_GEOMETRY_SHADER, geometry_file_path, GeometryShaderCode));
+	shaders.push_back(CompileShader(GL_FRAGMENT_SHADER, fragment_file_path, FragmentShaderCode));
+
+	return LinkProgram(shaders);
+}
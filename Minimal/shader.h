@@ -2,5 +2,6 @@
 #define SHADER_H
 
 GLuint LoadShaders(const char * vertex_file_path,const char * fragment_file_path);
+GLuint LoadShaders(const char * vertex_file_path, const char * geometry_file_path, const char * fragment_file_path);
 
 #endif
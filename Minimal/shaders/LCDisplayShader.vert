@@ -1,4 +1,5 @@
 #version 330 core
+#define MAX_WALLS 8
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
@@ -9,15 +10,24 @@ out vec4 FragPos;
 out vec3 eyepos;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 uniform vec3 planeNormal;
-uniform vec3 eyePos;
+
+//Per-eye state of the composite, written by Cave::writeEyeBlock() right before this pass
+layout(std140) uniform CaveEye {
+	vec4 caveEyePos;		//xyz
+	mat4 caveWarps[MAX_WALLS];	//wall image reprojection in the upper 3x3
+};
+
+//Camera of the current eye or wall pass (Shaders::setCamera)
+layout(std140) uniform Camera {
+	mat4 view;
+	mat4 projection;
+};
 
 void main(){
 	normal = planeNormal;
 	FragPos = model * vec4(aPos, 1.0);
-	eyepos = eyePos;
+	eyepos = caveEyePos.xyz;
 
 	TexCoords = aTexCoords;    
     gl_Position = projection * view * model * vec4(aPos, 1.0);
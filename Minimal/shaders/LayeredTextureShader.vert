@@ -0,0 +1,20 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+
+out vec2 vTexCoords;
+
+uniform mat4 model;
+
+//Camera of the wall pass (Shaders::setCamera), the geometry shader applies each wall's projection
+layout(std140) uniform Camera {
+	mat4 view;
+	mat4 projection;
+};
+
+void main()
+{
+    vTexCoords = aTexCoords;
+    gl_Position = view * model * vec4(aPos, 1.0);
+}
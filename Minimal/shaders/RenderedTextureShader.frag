@@ -1,14 +1,46 @@
 #version 330 core
+#define MAX_WALLS 8
 out vec4 FragColor;
 
 in vec2 TexCoords;
 in vec3 pos;
 
-uniform sampler2D texture_diffuse1;
-uniform vec3 eye;
+uniform sampler2DArray texture_diffuse1;
+uniform int layer;
+uniform float texScale;
+uniform samplerCube skybox;
+uniform bool analyticSkybox;
+uniform float skyboxExtent;
+
+//Per-eye state of the composite, written by Cave::writeEyeBlock() right before this pass
+layout(std140) uniform CaveEye {
+	vec4 caveEyePos;		//xyz
+	mat4 caveWarps[MAX_WALLS];	//wall image reprojection in the upper 3x3
+};
+
+//Point where the ray from the tracked eye through this wall fragment leaves the
+//skybox cube (centered at the origin). Sampling the cubemap there gives the same
+//texel a skybox pass rendered from the eye would have put on the wall.
+vec3 skyboxDirection(vec3 from, vec3 through){
+	vec3 dir = normalize(through - from);
+	vec3 bounds = sign(dir) * skyboxExtent;
+	vec3 t = (bounds - from) / dir;
+	return from + dir * min(t.x, min(t.y, t.z));
+}
 
 void main(){
-	vec4 base = texture(texture_diffuse1, TexCoords);
+	//Where this point of the wall was in the image (rendered from a slightly different eye position)
+	vec3 warped = mat3(caveWarps[layer]) * vec3(TexCoords, 1.0);
+
+	//Only the corner of the layer the wall was rendered at holds the image
+	float halfTexel = 0.5 / textureSize(texture_diffuse1, 0).x;
+	vec2 uv = clamp(warped.xy / warped.z * texScale, vec2(halfTexel), vec2(texScale - halfTexel));
+
+	vec4 base = texture(texture_diffuse1, vec3(uv, layer));
+
+	//The sky shows through where the wall image is transparent
+	if(analyticSkybox)
+		base = mix(texture(skybox, skyboxDirection(caveEyePos.xyz, pos)), base, base.a);
 	
 	//vec2 center = vec2(0.5, 0.5);
 	//float d = distance(TexCoords.xy, center);
@@ -6,8 +6,12 @@ layout (location = 2) in vec2 aTexCoords;
 out vec2 TexCoords;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+//Camera of the current eye or wall pass (Shaders::setCamera)
+layout(std140) uniform Camera {
+	mat4 view;
+	mat4 projection;
+};
 
 void main()
 {
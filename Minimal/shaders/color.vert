@@ -5,10 +5,14 @@ layout (location = 1) in vec3 aNormal;
 out vec3 color;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 uniform vec3 rgb;
 
+//Camera of the current eye or wall pass (Shaders::setCamera)
+layout(std140) uniform Camera {
+	mat4 view;
+	mat4 projection;
+};
+
 void main(){
     color = rgb;    
     gl_Position = projection * view * model * vec4(aPos, 1.0f);
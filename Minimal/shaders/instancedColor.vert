@@ -0,0 +1,19 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+//Per instance, from the RenderQueue's instance buffer (RENDER_INSTANCE_ATTRIB)
+layout (location = 3) in mat4 instanceModel;
+layout (location = 7) in vec3 instanceRgb;
+
+out vec3 color;
+
+//Camera of the current eye or wall pass (Shaders::setCamera)
+layout(std140) uniform Camera {
+	mat4 view;
+	mat4 projection;
+};
+
+void main(){
+    color = instanceRgb;
+    gl_Position = projection * view * instanceModel * vec4(aPos, 1.0f);
+}
\ No newline at end of file
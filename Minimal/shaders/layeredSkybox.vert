@@ -0,0 +1,19 @@
+#version 330 core
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 normal;
+
+out vec3 vTexCoords;
+
+uniform mat4 model;
+
+//Camera of the wall pass (Shaders::setCamera), the geometry shader applies each wall's projection
+layout(std140) uniform Camera {
+	mat4 view;
+	mat4 projection;
+};
+
+void main()
+{
+    vTexCoords = position;
+    gl_Position = view * model * vec4(position, 1.0);
+}
@@ -11,10 +11,14 @@ layout (location = 1) in vec3 normal;
 
 out vec3 TexCoords;
 
-uniform mat4 projection;
-uniform mat4 view;
 uniform mat4 model;
 
+//Camera of the current eye or wall pass (Shaders::setCamera)
+layout(std140) uniform Camera {
+	mat4 view;
+	mat4 projection;
+};
+
 void main()
 {
     TexCoords = position;